@@ -0,0 +1,35 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 21:02:31
+ *
+ * @brief iptools benchmarks launcher.*/
+
+// Google Benchmark
+#include <benchmark/benchmark.h>
+
+// benchmarks
+#include "bench_common.hpp"
+#include "bench_perf.hpp"
+#include "bench_cidr.hpp"
+#include "bench_lpfst.hpp"
+#include "bench_hybrid.hpp"
+
+int
+main(int argc, char* argv[])
+{
+	// our options are removed before Google Benchmark sees them
+	int n = 1;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--perf_counters") == 0)
+			perf_counters::enabled() = true;
+		else
+			argv[n++] = argv[i];
+	}
+	argc = n;
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
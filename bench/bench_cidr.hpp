@@ -0,0 +1,94 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 21:38:55
+ *
+ * @brief cidr_v4 and cidr_v6 parsing, formatting and iteration*/
+
+template<class Family> const std::vector<std::string>&
+cidr_strings()
+{
+	static const std::vector<std::string> rs = []()
+		{
+			std::vector<std::string> strs;
+			for (const auto& prefix : fixture<Family>::prefixes(1 << 12))
+				strs.push_back(prefix.str());
+			return strs;
+		}();
+	return rs;
+}
+
+template<class Family> void
+BM_cidr_parse(benchmark::State& state)
+{
+	const auto& strs = cidr_strings<Family>();
+	size_t i = 0;
+	typename Family::cidr addr;
+	for (auto _ : state)
+	{
+		const std::string& str = strs[i++ % strs.size()];
+		benchmark::DoNotOptimize(Family::cidr::parse(str.data(), str.size(), addr));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**@brief legacy std::string constructor (inet_pton)*/
+template<class Family> void
+BM_cidr_from_string(benchmark::State& state)
+{
+	const auto& strs = cidr_strings<Family>();
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		typename Family::cidr addr(strs[i++ % strs.size()]);
+		benchmark::DoNotOptimize(addr);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<class Family> void
+BM_cidr_to_chars(benchmark::State& state)
+{
+	const auto& prefixes = fixture<Family>::prefixes(1 << 12);
+	char buf[Family::cidr::max_str_len];
+	size_t i = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(prefixes[i++ % prefixes.size()].to_chars(buf, buf + sizeof(buf)));
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<class Family> void
+BM_cidr_str(benchmark::State& state)
+{
+	const auto& prefixes = fixture<Family>::prefixes(1 << 12);
+	size_t i = 0;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(prefixes[i++ % prefixes.size()].str());
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**@brief walk every address of the /16*/
+static void
+BM_cidr_v4_iterate(benchmark::State& state)
+{
+	const cidr_v4 net("10.20.0.0/16");
+	for (auto _ : state)
+	{
+		uint32_t sum = 0;
+		for (auto i = net.begin(); i != net.end(); ++i)
+			sum += (uint32_t)*i;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations()*(1 << 16));
+}
+
+BENCHMARK_TEMPLATE(BM_cidr_parse, family_v4);
+BENCHMARK_TEMPLATE(BM_cidr_parse, family_v6);
+BENCHMARK_TEMPLATE(BM_cidr_from_string, family_v4);
+BENCHMARK_TEMPLATE(BM_cidr_from_string, family_v6);
+BENCHMARK_TEMPLATE(BM_cidr_to_chars, family_v4);
+BENCHMARK_TEMPLATE(BM_cidr_to_chars, family_v6);
+BENCHMARK_TEMPLATE(BM_cidr_str, family_v4);
+BENCHMARK_TEMPLATE(BM_cidr_str, family_v6);
+BENCHMARK(BM_cidr_v4_iterate);
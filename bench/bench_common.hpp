@@ -0,0 +1,130 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 21:07:40
+ *
+ * @brief prefix sets, traffic traces and cached tables for benchmarks*/
+
+#include <iptools/lpfst.hpp>
+#include <iptools/lpfst_v6.hpp>
+#include <iptools/generator.hpp>
+#include <iptools/flow_cache.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace iptools;
+
+/**@brief kind of the lookup trace*/
+enum traffic
+{
+	uniform = 0, //!< every prefix is hit equally often
+	zipf    = 1, //!< prefix popularity follows Zipf's law (s = 1)
+	miss    = 2, //!< addresses outside the table
+	flows   = 3  //!< Zipf popularity over 4096 repeated addresses
+};
+
+/**@brief trace profile of the traffic kind*/
+inline trace_profile
+make_trace_profile(traffic kind)
+{
+	trace_profile rs;
+	rs.hit_ratio = kind == miss ? 0 : 1;
+	rs.zipf      = kind == zipf || kind == flows ? 1 : 0;
+	rs.flows     = kind == flows ? 4096 : 0;
+	return rs;
+}
+
+/**@brief IPv4 and IPv6 variants of the benchmarked types*/
+struct family_v4
+{
+	using cidr  = cidr_v4;
+	using addr  = uint32_t;
+	using table = basic_lpfst<uint32_t>;
+	using cache = flow_cache<addr, table>;
+
+	static std::vector<cidr> prefixes(size_t n) { return generate_prefixes_v4(n); }
+	static std::vector<addr> trace(const std::vector<cidr>& p, size_t n, traffic kind)
+	{
+		return generate_trace_v4(p, n, 2, make_trace_profile(kind));
+	}
+};
+
+struct family_v6
+{
+	using cidr  = cidr_v6;
+	using addr  = in6_addr_t;
+	using table = basic_lpfst_v6<uint32_t>;
+	using cache = flow_cache<addr, table>;
+
+	static std::vector<cidr> prefixes(size_t n) { return generate_prefixes_v6(n); }
+	static std::vector<addr> trace(const std::vector<cidr>& p, size_t n, traffic kind)
+	{
+		return generate_trace_v6(p, n, 2, make_trace_profile(kind));
+	}
+};
+
+/**@brief generated data is shared by benchmarks and threads*/
+template<class Family>
+class fixture
+{
+public:
+	using cidr  = typename Family::cidr;
+	using addr  = typename Family::addr;
+	using table = typename Family::table;
+
+	static const size_t trace_size = 1 << 16;
+
+	static const std::vector<cidr>& prefixes(size_t n)
+	{
+		std::lock_guard<std::mutex> lock(mutex());
+		auto& rs = get()->prefixes[n];
+		if (rs.empty())
+			rs = Family::prefixes(n);
+		return rs;
+	}
+
+	/**@brief table with the prefixes(n), data is the prefix index*/
+	static const table& tbl(size_t n)
+	{
+		const std::vector<cidr>& from = prefixes(n);
+		std::lock_guard<std::mutex> lock(mutex());
+		std::unique_ptr<table>& rs = get()->tables[n];
+		if (!rs)
+		{
+			rs.reset(new table);
+			for (size_t i = 0; i < from.size(); ++i)
+				rs->insert(from[i], static_cast<uint32_t>(i));
+		}
+		return *rs;
+	}
+
+	static const std::vector<addr>& trace(size_t n, traffic kind)
+	{
+		const std::vector<cidr>& from = prefixes(n);
+		std::lock_guard<std::mutex> lock(mutex());
+		auto& rs = get()->traces[std::make_pair(n, kind)];
+		if (rs.empty())
+			rs = Family::trace(from, trace_size, kind);
+		return rs;
+	}
+
+private:
+	struct storage
+	{
+		std::map<size_t, std::vector<cidr> >                   prefixes;
+		std::map<size_t, std::unique_ptr<table> >              tables;
+		std::map<std::pair<size_t, int>, std::vector<addr> >   traces;
+	};
+
+	static std::mutex& mutex()
+	{
+		static std::mutex rs;
+		return rs;
+	}
+
+	static storage* get()
+	{
+		static storage rs;
+		return &rs;
+	}
+};
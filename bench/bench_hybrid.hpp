@@ -0,0 +1,61 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 02:38:51
+ *
+ * @brief basic_lpfst against basic_hybrid_lpfst on the host heavy
+ * (blacklist like) tables, range(0) is the number of prefixes*/
+
+#include <iptools/hybrid_lpfst.hpp>
+
+/**@brief 3/4 of the prefixes are /32 hosts, the rest follows BGP*/
+static const std::vector<std::pair<cidr_v4, uint32_t> >&
+host_heavy_list(size_t n)
+{
+	static std::mutex mutex;
+	static std::map<size_t, std::vector<std::pair<cidr_v4, uint32_t> > > lists;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& rs = lists[n];
+	if (rs.empty())
+	{
+		prefix_profile profile = prefix_profile::bgp_v4();
+		double sum = 0;
+		for (const auto& l : profile.lengths)
+			sum += l.second;
+		profile.lengths.push_back(std::make_pair(32, 3*sum));
+		auto prefixes = generate_prefixes_v4(n, 1, profile);
+		for (size_t i = 0; i < prefixes.size(); ++i)
+			rs.emplace_back(prefixes[i], static_cast<uint32_t>(i));
+	}
+	return rs;
+}
+
+template<class Table> void
+BM_host_heavy_check(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& list = host_heavy_list(n);
+	Table tbl(list.begin(), list.end());
+	std::vector<cidr_v4> prefixes;
+	for (const auto& p : list)
+		prefixes.push_back(p.first);
+	trace_profile profile;
+	profile.hit_ratio = 0.5;
+	const auto trace = generate_trace_v4(prefixes, 1 << 16, 2, profile);
+	const size_t mask = trace.size() - 1;
+	size_t i = 0;
+	size_t found = 0;
+	uint32_t data = 0;
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		found += tbl.check(trace[i++ & mask], data);
+		benchmark::DoNotOptimize(data);
+	}
+	perf.stop();
+	perf.report(state);
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_host_heavy_check, basic_lpfst<uint32_t>)->Arg(1 << 15)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_host_heavy_check, basic_hybrid_lpfst<uint32_t>)->Arg(1 << 15)->Arg(1 << 20);
@@ -0,0 +1,223 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 21:24:18
+ *
+ * @brief basic_lpfst and basic_lpfst_v6 benchmarks, range(0) is the
+ * number of prefixes. With --perf_counters hardware counters are reported
+ * per processed item (prefix or lookup).*/
+
+static void
+table_sizes(benchmark::internal::Benchmark* b)
+{
+	for (int64_t n : {1 << 10, 1 << 15, 1 << 20})
+		b->Arg(n);
+}
+
+static void
+table_sizes_traffic(benchmark::internal::Benchmark* b)
+{
+	for (int64_t n : {1 << 10, 1 << 15, 1 << 20})
+		for (int64_t kind : {uniform, zipf, miss, flows})
+			b->Args({n, kind});
+}
+
+/**@brief repeated addresses, the flow cache workload*/
+static void
+table_sizes_flows(benchmark::internal::Benchmark* b)
+{
+	for (int64_t n : {1 << 10, 1 << 15, 1 << 20})
+		for (int64_t kind : {zipf, flows})
+			b->Args({n, kind});
+}
+
+template<class Family> void
+BM_lpfst_insert(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& prefixes = fixture<Family>::prefixes(n);
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		typename Family::table tbl;
+		for (size_t i = 0; i < n; ++i)
+			tbl.insert(prefixes[i], static_cast<uint32_t>(i));
+		benchmark::DoNotOptimize(tbl.size());
+	}
+	perf.stop();
+	perf.report(state, n);
+	state.SetItemsProcessed(state.iterations()*n);
+}
+
+template<class Family> void
+BM_lpfst_bulk_load(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& prefixes = fixture<Family>::prefixes(n);
+	std::vector<std::pair<typename Family::cidr, uint32_t> > list;
+	for (size_t i = 0; i < n; ++i)
+		list.emplace_back(prefixes[i], static_cast<uint32_t>(i));
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		typename Family::table tbl(list.begin(), list.end());
+		benchmark::DoNotOptimize(tbl.size());
+	}
+	perf.stop();
+	perf.report(state, n);
+	state.SetItemsProcessed(state.iterations()*n);
+}
+
+template<class Family> void
+BM_lpfst_remove(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& prefixes = fixture<Family>::prefixes(n);
+	const auto& from = fixture<Family>::tbl(n);
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		perf.stop();
+		state.PauseTiming();
+		typename Family::table tbl(from);
+		state.ResumeTiming();
+		perf.start();
+		for (size_t i = 0; i < n; ++i)
+			tbl.remove(prefixes[i]);
+		benchmark::DoNotOptimize(tbl.empty());
+	}
+	perf.stop();
+	perf.report(state, n);
+	state.SetItemsProcessed(state.iterations()*n);
+}
+
+/**@brief range(1) is the traffic kind*/
+template<class Family> void
+BM_lpfst_check(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& tbl = fixture<Family>::tbl(n);
+	const auto& trace = fixture<Family>::trace(n, static_cast<traffic>(state.range(1)));
+	const size_t mask = trace.size() - 1;
+	size_t i = 0;
+	size_t found = 0;
+	uint32_t data = 0;
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		found += tbl.check(trace[i++ & mask], data);
+		benchmark::DoNotOptimize(data);
+	}
+	perf.stop();
+	perf.report(state);
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**@brief check() through the flow_cache, range(1) is the traffic kind*/
+template<class Family> void
+BM_lpfst_check_cached(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& tbl = fixture<Family>::tbl(n);
+	const auto& trace = fixture<Family>::trace(n, static_cast<traffic>(state.range(1)));
+	typename Family::cache cache(tbl);
+	const size_t mask = trace.size() - 1;
+	size_t i = 0;
+	size_t found = 0;
+	uint32_t data = 0;
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		found += cache.check(trace[i++ & mask], data);
+		benchmark::DoNotOptimize(data);
+	}
+	perf.stop();
+	perf.report(state);
+	benchmark::DoNotOptimize(found);
+	state.counters["cache_hits"] = benchmark::Counter((double)cache.hits()/state.iterations());
+	state.SetItemsProcessed(state.iterations());
+}
+
+/**@brief lookups from several threads in the shared table*/
+template<class Family> void
+BM_lpfst_check_threads(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& tbl = fixture<Family>::tbl(n);
+	const auto& trace = fixture<Family>::trace(n, zipf);
+	const size_t mask = trace.size() - 1;
+	size_t i = state.thread_index()*(trace.size()/8);
+	size_t found = 0;
+	uint32_t data = 0;
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		found += tbl.check(trace[i++ & mask], data);
+		benchmark::DoNotOptimize(data);
+	}
+	perf.stop();
+	perf.report(state);
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+template<class Family> void
+BM_lpfst_copy(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& from = fixture<Family>::tbl(n);
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		typename Family::table tbl(from);
+		benchmark::DoNotOptimize(tbl.size());
+	}
+	perf.stop();
+	perf.report(state, n);
+	state.SetItemsProcessed(state.iterations()*n);
+}
+
+template<class Family> void
+BM_lpfst_clear(benchmark::State& state)
+{
+	const size_t n = state.range(0);
+	const auto& from = fixture<Family>::tbl(n);
+	perf_counters perf;
+	perf.start();
+	for (auto _ : state)
+	{
+		perf.stop();
+		state.PauseTiming();
+		typename Family::table tbl(from);
+		state.ResumeTiming();
+		perf.start();
+		tbl.clear();
+		benchmark::DoNotOptimize(tbl.empty());
+	}
+	perf.stop();
+	perf.report(state, n);
+	state.SetItemsProcessed(state.iterations()*n);
+}
+
+BENCHMARK_TEMPLATE(BM_lpfst_insert, family_v4)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_insert, family_v6)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_bulk_load, family_v4)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_bulk_load, family_v6)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_remove, family_v4)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_remove, family_v6)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_check, family_v4)->Apply(table_sizes_traffic);
+BENCHMARK_TEMPLATE(BM_lpfst_check, family_v6)->Apply(table_sizes_traffic);
+BENCHMARK_TEMPLATE(BM_lpfst_check_cached, family_v4)->Apply(table_sizes_flows);
+BENCHMARK_TEMPLATE(BM_lpfst_check_cached, family_v6)->Apply(table_sizes_flows);
+BENCHMARK_TEMPLATE(BM_lpfst_check_threads, family_v4)->Arg(1 << 20)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_lpfst_check_threads, family_v6)->Arg(1 << 20)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_lpfst_copy, family_v4)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_copy, family_v6)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_clear, family_v4)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_lpfst_clear, family_v6)->Apply(table_sizes)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,162 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 00:21:44
+ *
+ * @brief hardware performance counters (Linux perf_event_open) reported
+ * by the benchmarks started with --perf_counters*/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**@brief Counters of the calling thread
+ *
+ * Every event is opened separately (user space only), so the unsupported
+ * ones are skipped and the rest still works. Values are scaled if the
+ * kernel multiplexed the events. Nothing is opened unless enabled().*/
+class perf_counters
+{
+public:
+	perf_counters()
+	{
+		if (!enabled())
+			return;
+#ifdef __linux__
+		const event events[] = {
+			{"cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			{"instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			{"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+			{"L1d_misses",    PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D)},
+			{"LLC_misses",    PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL)},
+			{"dTLB_misses",   PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB)}
+		};
+		for (const event& e : events)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size           = sizeof(attr);
+			attr.type           = e.type;
+			attr.config         = e.config;
+			attr.disabled       = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv     = 1;
+			attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+			if (fd < 0)
+			{
+				warn(e.name, errno);
+				continue;
+			}
+			counters_.push_back({e.name, fd});
+		}
+#endif
+	}
+
+	~perf_counters()
+	{
+#ifdef __linux__
+		for (const counter& c : counters_)
+			close(c.fd);
+#endif
+	}
+
+	perf_counters(const perf_counters&) = delete;
+	perf_counters& operator=(const perf_counters&) = delete;
+
+	/**@brief set by the --perf_counters option*/
+	static bool& enabled()
+	{
+		static bool rs = false;
+		return rs;
+	}
+
+	/**@brief count the events until stop(), adds to the previous runs*/
+	void start()
+	{
+#ifdef __linux__
+		for (const counter& c : counters_)
+			ioctl(c.fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+	}
+
+	void stop()
+	{
+#ifdef __linux__
+		for (const counter& c : counters_)
+			ioctl(c.fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+	}
+
+	/**@brief add counters per item (lookup, insert...) to the benchmark
+	 * results, summed over the threads
+	 * @param items processed on every iteration*/
+	void report(benchmark::State& state, size_t items = 1)
+	{
+#ifdef __linux__
+		double cycles = 0, instructions = 0;
+		for (const counter& c : counters_)
+		{
+			// value, time enabled, time running
+			uint64_t v[3];
+			if (read(c.fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+				continue;
+			double value = v[0]*((double)v[1]/v[2]);
+			state.counters[c.name] = benchmark::Counter(value/items, benchmark::Counter::kAvgIterations);
+			if (strcmp(c.name, "cycles") == 0)
+				cycles = value;
+			else if (strcmp(c.name, "instructions") == 0)
+				instructions = value;
+		}
+		// of the first thread, other threads do not add to it
+		if (cycles > 0 && state.thread_index() == 0)
+			state.counters["IPC"] = instructions/cycles;
+#else
+		(void)state;
+		(void)items;
+#endif
+	}
+
+private:
+	struct event
+	{
+		const char* name;
+		uint32_t    type;
+		uint64_t    config;
+	};
+
+	struct counter
+	{
+		const char* name;
+		int         fd;
+	};
+
+#ifdef __linux__
+	static uint64_t cache_event(uint64_t cache)
+	{
+		return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+	}
+#endif
+
+	/**@brief report every unavailable event once*/
+	static void warn(const char* name, int err)
+	{
+		static std::vector<std::string> reported;
+		static std::mutex mutex;
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const std::string& r : reported)
+			if (r == name)
+				return;
+		reported.push_back(name);
+		fprintf(stderr, "perf_event_open(%s): %s\n", name, strerror(err));
+	}
+
+	std::vector<counter> counters_;
+};
@@ -0,0 +1,139 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 22:31:48
+ *
+ * @brief synthetic prefix table and address trace generator.*/
+
+#include <iptools/generator.hpp>
+#include <iptools/bulk_formatter.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace iptools;
+
+static void
+usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s [-6] [-n prefixes] [-t trace] [-s seed] [-r hit_ratio] [-z zipf] [-f flows]\n"
+		"          [-b] [-p prefixes_file] [-a trace_file]\n"
+		"  -6  IPv6 (IPv4 by default)\n"
+		"  -n  number of prefixes (100000)\n"
+		"  -t  number of trace addresses (1000000)\n"
+		"  -s  seed (1), the same seed gives the same output\n"
+		"  -r  share of trace addresses hitting the prefixes (1.0)\n"
+		"  -z  Zipf exponent of the prefix popularity (0 - uniform)\n"
+		"  -f  number of distinct trace addresses repeated with the Zipf\n"
+		"      popularity (0 - every address is new)\n"
+		"  -b  write the trace as the binary array (host byte order uint32_t\n"
+		"      or 16-byte in6_addr_t) instead of text\n"
+		"  -p  prefixes output, one cidr per line\n"
+		"  -a  trace output\n", name);
+}
+
+/**@brief write addresses by chunks with format_fields, one per line*/
+template<class Addr> static bool
+write_text(FILE* out, const Addr* addrs, const uint8_t* masks, size_t n)
+{
+	std::vector<char> buf(1 << 20);
+	while (n > 0)
+	{
+		size_t written = 0;
+		size_t cnt = format_fields(addrs, masks, n, '\n', buf.data(), buf.size(), &written);
+		if (fwrite(buf.data(), 1, written, out) != written)
+			return false;
+		addrs += cnt;
+		if (masks)
+			masks += cnt;
+		n -= cnt;
+	}
+	return true;
+}
+
+template<class Cidr, class Addr> static bool
+write(const char* prefixes_file, const std::vector<Cidr>& prefixes,
+      const char* trace_file, const std::vector<Addr>& trace, bool binary)
+{
+	if (prefixes_file)
+	{
+		std::vector<Addr>    addrs;
+		std::vector<uint8_t> masks;
+		for (const auto& p : prefixes)
+		{
+			addrs.push_back(p);
+			masks.push_back(static_cast<uint8_t>(p.mask()));
+		}
+		FILE* out = fopen(prefixes_file, "w");
+		bool ok = out && write_text(out, addrs.data(), masks.data(), addrs.size());
+		if (!out || fclose(out) != 0 || !ok)
+		{
+			perror(prefixes_file);
+			return false;
+		}
+	}
+	if (trace_file)
+	{
+		FILE* out = fopen(trace_file, binary ? "wb" : "w");
+		bool ok = out && (binary
+			? fwrite(trace.data(), sizeof(Addr), trace.size(), out) == trace.size()
+			: write_text(out, trace.data(), (const uint8_t*)nullptr, trace.size()));
+		if (!out || fclose(out) != 0 || !ok)
+		{
+			perror(trace_file);
+			return false;
+		}
+	}
+	return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+	bool          v6 = false;
+	bool          binary = false;
+	size_t        prefixes = 100000;
+	size_t        trace = 1000000;
+	uint32_t      seed = 1;
+	trace_profile profile;
+	const char*   prefixes_file = nullptr;
+	const char*   trace_file = nullptr;
+	int opt;
+	while ((opt = getopt(argc, argv, "6n:t:s:r:z:f:bp:a:h")) != -1)
+	{
+		switch (opt)
+		{
+			case '6': v6 = true; break;
+			case 'n': prefixes = strtoull(optarg, nullptr, 10); break;
+			case 't': trace = strtoull(optarg, nullptr, 10); break;
+			case 's': seed = static_cast<uint32_t>(strtoul(optarg, nullptr, 10)); break;
+			case 'r': profile.hit_ratio = atof(optarg); break;
+			case 'z': profile.zipf = atof(optarg); break;
+			case 'f': profile.flows = strtoull(optarg, nullptr, 10); break;
+			case 'b': binary = true; break;
+			case 'p': prefixes_file = optarg; break;
+			case 'a': trace_file = optarg; break;
+			default:
+				usage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (!prefixes_file && !trace_file)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	bool ok;
+	if (v6)
+	{
+		auto p = generate_prefixes_v6(prefixes, seed);
+		auto t = generate_trace_v6(p, trace_file ? trace : 0, seed + 1, profile);
+		ok = write(prefixes_file, p, trace_file, t, binary);
+	}
+	else
+	{
+		auto p = generate_prefixes_v4(prefixes, seed);
+		auto t = generate_trace_v4(p, trace_file ? trace : 0, seed + 1, profile);
+		ok = write(prefixes_file, p, trace_file, t, binary);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 20:41:09 */
+
+#pragma once
+#include "cidr.hpp"
+#include "lpfst_v6.hpp"
+
+namespace iptools {
+
+/**@brief write fields one by one with to_chars, each followed by delim*/
+template<class Cidr, class Addr> size_t
+format_fields_impl(const Addr* addrs, const uint8_t* masks, size_t n, uint8_t full,
+                   char delim, char* out, size_t len, size_t* written)
+{
+	char*       p   = out;
+	char* const end = out + len;
+	size_t i = 0;
+	for (; i < n; ++i)
+	{
+		char* next = Cidr(addrs[i], masks ? masks[i] : full).to_chars(p, end, masks == nullptr);
+		if (next == nullptr || next == end)
+			break;
+		*next++ = delim;
+		p = next;
+	}
+	if (written)
+		*written = p - out;
+	return i;
+}
+
+/**@brief write n addresses into one text buffer (the reverse of
+ * parse_fields)
+ *
+ * Every field is "a.b.c.d/len" ("a.b.c.d" if masks is null) followed by
+ * delim. The output is not null-terminated.
+ * @param addrs host byte order addresses
+ * @param masks prefix lengths (0-32) or nullptr
+ * @param written if not null, set to the number of bytes written
+ * @return number of fields written, less than n if the buffer is full
+ * (cidr_v4::max_str_len + 1 bytes per field is always enough)*/
+inline size_t
+format_fields(const uint32_t* addrs, const uint8_t* masks, size_t n, char delim,
+              char* out, size_t len, size_t* written = nullptr)
+{
+	return format_fields_impl<iptools::cidr_v4>(addrs, masks, n, 32, delim, out, len, written);
+}
+
+/**@brief the same for IPv6 addresses, masks are 0-128
+ * (cidr_v6::max_str_len + 1 bytes per field is always enough)*/
+inline size_t
+format_fields(const in6_addr_t* addrs, const uint8_t* masks, size_t n, char delim,
+              char* out, size_t len, size_t* written = nullptr)
+{
+	return format_fields_impl<iptools::cidr_v6>(addrs, masks, n, 128, delim, out, len, written);
+}
+
+} // namespace
@@ -0,0 +1,137 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 19:55:21 */
+
+#pragma once
+#include "cidr.hpp"
+#include "compiler.hpp"
+#include "simd.hpp"
+#include "lpfst_v6.hpp"
+#include <cstring>
+
+namespace iptools {
+
+/**@brief mask length of the field that is not a valid address*/
+static const uint8_t invalid_field = 0xFF;
+
+inline void
+store_field(const iptools::cidr_v4& from, uint32_t& addr)
+{
+	addr = from;
+}
+
+inline void
+store_field(const iptools::cidr_v6& from, in6_addr_t& addr)
+{
+	addr = from;
+}
+
+/**@brief walk the buffer by 64-byte blocks, Scan finds the separators*/
+template<class Cidr, class Addr, uint64_t (*Scan)(const char*, char, char)> size_t
+parse_fields_blocks(const char* data, size_t len, char delim, Addr* addrs, uint8_t* masks,
+                    size_t max, size_t* consumed)
+{
+	size_t n = 0;
+	size_t field = 0;
+	auto emit = [&](size_t end)
+		{
+			if (end > field && data[end - 1] == '\r')
+				--end;
+			if (end == field)
+				return;
+			Cidr cidr;
+			if (Cidr::parse(data + field, end - field, cidr) == parse_error::ok)
+			{
+				store_field(cidr, addrs[n]);
+				masks[n] = cidr.mask();
+			}
+			else
+			{
+				addrs[n] = Addr();
+				masks[n] = invalid_field;
+			}
+			++n;
+		};
+	for (size_t pos = 0; pos < len && n < max; pos += 64)
+	{
+		uint64_t bits;
+		if (len - pos >= 64)
+		{
+			bits = Scan(data + pos, delim, '\n');
+		}
+		else
+		{
+			char tail[64] = {0};
+			memcpy(tail, data + pos, len - pos);
+			bits = Scan(tail, delim, '\n') & ((1ULL << (len - pos)) - 1);
+		}
+		while (bits && n < max)
+		{
+			size_t end = pos + ctz64(bits);
+			bits &= bits - 1;
+			emit(end);
+			field = end + 1;
+		}
+	}
+	if (n < max && field < len)
+	{
+		emit(len);
+		field = len;
+	}
+	if (consumed)
+		*consumed = field < len ? field : len;
+	return n;
+}
+
+template<class Cidr, class Addr> size_t
+parse_fields_dispatch(const char* data, size_t len, char delim, Addr* addrs, uint8_t* masks,
+                      size_t max, size_t* consumed, simd_level level)
+{
+	if (level > simd_detect())
+		level = simd_detect();
+	switch (level)
+	{
+#ifdef IPTOOLS_X86_SIMD
+		case simd_level::avx512:
+		case simd_level::avx2:
+			return parse_fields_blocks<Cidr, Addr, scan_separators_avx2>(data, len, delim, addrs, masks, max, consumed);
+		case simd_level::sse2:
+			return parse_fields_blocks<Cidr, Addr, scan_separators_sse2>(data, len, delim, addrs, masks, max, consumed);
+#endif
+		default:
+			return parse_fields_blocks<Cidr, Addr, scan_separators_scalar>(data, len, delim, addrs, masks, max, consumed);
+	}
+}
+
+/**@brief parse the buffer of "a.b.c.d[/len]" fields into arrays
+ *
+ * Fields are separated by delim or '\n', empty fields are skipped and a
+ * trailing '\r' is ignored. Separators are located by 64-byte blocks with
+ * SIMD compares, fields are converted with cidr_v4::parse. The last field
+ * does not need the separator, so the buffer should end on a field
+ * boundary.
+ * @param addrs host byte order addresses (0 for invalid fields), ready for
+ * basic_lpfst::check and check_batch
+ * @param masks prefix lengths (32 without "/len"), invalid_field if the
+ * field is not an address
+ * @param max capacity of addrs and masks
+ * @param consumed if not null, set to the number of bytes processed, less
+ * than len if max fields were stored
+ * @param level the kernel to use, falls back to the best supported one
+ * @return number of fields stored*/
+inline size_t
+parse_fields(const char* data, size_t len, char delim, uint32_t* addrs, uint8_t* masks,
+             size_t max, size_t* consumed = nullptr, simd_level level = simd_detect())
+{
+	return parse_fields_dispatch<iptools::cidr_v4>(data, len, delim, addrs, masks, max, consumed, level);
+}
+
+/**@brief the same for IPv6 fields (cidr_v6::parse), masks are 128 without
+ * "/len"*/
+inline size_t
+parse_fields(const char* data, size_t len, char delim, in6_addr_t* addrs, uint8_t* masks,
+             size_t max, size_t* consumed = nullptr, simd_level level = simd_detect())
+{
+	return parse_fields_dispatch<iptools::cidr_v6>(data, len, delim, addrs, masks, max, consumed, level);
+}
+
+} // namespace
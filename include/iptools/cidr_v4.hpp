@@ -3,28 +3,46 @@
 
 #pragma once
 
+#include "compiler.hpp"
+#include "parse_error.hpp"
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <algorithm>
 #include <memory>
 #include <arpa/inet.h>
+#ifdef IPTOOLS_HAS_STRING_VIEW
+#include <string_view>
+#endif
 
 namespace iptools {
 
 class cidr_v4
 {
 public:
-	cidr_v4() {}
+	constexpr cidr_v4() {}
 	cidr_v4(std::string str);
 	/**@param addr should be in host byte order*/
-	cidr_v4(uint32_t addr, uint8_t mask) : addr_(addr), mask_(32-mask) {}
+	constexpr cidr_v4(uint32_t addr, uint8_t mask) : addr_(addr), mask_(32-mask) {}
 	~cidr_v4() = default;
 
+	/**@brief parse "a.b.c.d[/len]" (len is 32 if omitted) without allocations
+	 *
+	 * Unlike cidr_v4(std::string) the whole range should be the address, out
+	 * is not changed on error. constexpr since C++14.*/
+	static IPTOOLS_CONSTEXPR14 parse_error parse(const char* str, size_t len, cidr_v4& out);
+#ifdef IPTOOLS_HAS_STRING_VIEW
+	static constexpr parse_error parse(std::string_view str, cidr_v4& out)
+	{
+		return parse(str.data(), str.size(), out);
+	}
+#endif
+
 	bool operator==(const cidr_v4& rhv) const;
 	bool operator!=(const cidr_v4& rhv) const;
-	operator uint32_t() const { return addr_; }
-	uint32_t mask() const { return 32-mask_; }
+	constexpr operator uint32_t() const { return addr_; }
+	constexpr uint32_t mask() const { return 32-mask_; }
 
 	/**@brief get first address (network address in host byte order) in the network*/
 	uint32_t    first() const { return (addr_>>mask_)<<mask_; }
@@ -39,6 +57,15 @@ public:
 	/**@brief convert to string*/
 	std::string str(bool nomask = false) const;
 
+	/**@brief maximal length of the text form ("255.255.255.255/32")*/
+	static const size_t max_str_len = 18;
+
+	/**@brief write str() to [first, last) without allocations, the result
+	 * is not null-terminated
+	 * @return pointer past the last written char, nullptr if the buffer is
+	 * too small (nothing is written in this case)*/
+	char* to_chars(char* first, char* last, bool nomask = false) const;
+
 	class const_iterator;
 	const_iterator     begin() const;
 	const_iterator     end() const;
@@ -105,6 +132,46 @@ namespace std
 
 namespace iptools {
 
+IPTOOLS_CONSTEXPR14 parse_error
+cidr_v4::parse(const char* str, size_t len, cidr_v4& out)
+{
+	if (len == 0)
+		return parse_error::empty;
+	uint32_t addr = 0;
+	size_t   i    = 0;
+	for (int octet = 0; octet < 4; ++octet)
+	{
+		if (octet > 0)
+		{
+			if (i == len || str[i] != '.')
+				return parse_error::bad_address;
+			++i;
+		}
+		size_t   first = i;
+		uint32_t value = 0;
+		while (i < len && i - first < 3 && str[i] >= '0' && str[i] <= '9')
+			value = value*10 + (str[i++] - '0');
+		// no leading zeros, same as inet_pton
+		if (i == first || value > 255 || (str[first] == '0' && i - first > 1))
+			return parse_error::bad_address;
+		addr = (addr << 8) | value;
+	}
+	uint32_t mask = 32;
+	if (i < len)
+	{
+		if (str[i] != '/')
+			return parse_error::bad_address;
+		size_t first = ++i;
+		mask = 0;
+		while (i < len && i - first < 2 && str[i] >= '0' && str[i] <= '9')
+			mask = mask*10 + (str[i++] - '0');
+		if (i == first || i != len || mask > 32)
+			return parse_error::bad_mask;
+	}
+	out = cidr_v4(addr, static_cast<uint8_t>(mask));
+	return parse_error::ok;
+}
+
 inline
 cidr_v4::cidr_v4(std::string str)
 	: addr_(0)
@@ -141,15 +208,38 @@ cidr_v4::cidr_v4(std::string str)
 inline std::string
 cidr_v4::str(bool nomask) const
 {
-	char tmp[20];
-	uint32_t addr = htonl(addr_);
-	if (inet_ntop(AF_INET, &addr, tmp, sizeof(tmp)) == NULL)
-		return std::string();
-	if (nomask)
-		return tmp;
-	std::stringstream ss;
-	ss << tmp << "/" << 32-mask_;
-	return ss.str();
+	char tmp[max_str_len];
+	return std::string(tmp, to_chars(tmp, tmp + sizeof(tmp), nomask));
+}
+
+inline char*
+cidr_v4::to_chars(char* first, char* last, bool nomask) const
+{
+	char  tmp[max_str_len];
+	char* p = tmp;
+	auto put = [&p](unsigned v)
+		{
+			if (v >= 100)
+				*p++ = '0' + v/100;
+			if (v >= 10)
+				*p++ = '0' + v/10%10;
+			*p++ = '0' + v%10;
+		};
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		put((addr_ >> shift) & 0xFF);
+		if (shift > 0)
+			*p++ = '.';
+	}
+	if (!nomask)
+	{
+		*p++ = '/';
+		put(32 - mask_);
+	}
+	if (p - tmp > last - first)
+		return nullptr;
+	memcpy(first, tmp, p - tmp);
+	return first + (p - tmp);
 }
 
 inline bool
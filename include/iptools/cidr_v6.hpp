@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "cidr_v4.hpp"
 #include <string>
 #include <iostream>
 #include <array>
@@ -21,16 +22,29 @@ std::string
 class cidr_v6
 {
 public:
-	cidr_v6() {}
+	constexpr cidr_v6() {}
 	cidr_v6(std::string str);
 	/**@param addr should be in host byte order*/
-	cidr_v6(std::array<uint8_t, 16> addr, uint8_t mask) : addr_(addr), mask_(mask) {}
+	constexpr cidr_v6(std::array<uint8_t, 16> addr, uint8_t mask) : addr_(addr), mask_(mask) {}
 	~cidr_v6() = default;
 
+	/**@brief parse "ipv6[/len]" (len is 128 if omitted) without allocations
+	 *
+	 * RFC 4291 text forms are accepted, including "::" and the trailing
+	 * dotted quad. Unlike cidr_v6(std::string) the whole range should be
+	 * the address, out is not changed on error. constexpr since C++14.*/
+	static IPTOOLS_CONSTEXPR14 parse_error parse(const char* str, size_t len, cidr_v6& out);
+#ifdef IPTOOLS_HAS_STRING_VIEW
+	static constexpr parse_error parse(std::string_view str, cidr_v6& out)
+	{
+		return parse(str.data(), str.size(), out);
+	}
+#endif
+
 	bool operator==(const cidr_v6& rhv) const;
 	bool operator!=(const cidr_v6& rhv) const;
-	operator std::array<uint8_t, 16>() const { return addr_; }
-	uint32_t mask() const { return mask_; }
+	constexpr operator std::array<uint8_t, 16>() const { return addr_; }
+	constexpr uint32_t mask() const { return mask_; }
 
 	/**@brief get first address (network address in host byte order) in the network*/
     std::array<uint8_t, 16> first() const;
@@ -44,6 +58,19 @@ public:
 	cidr_v6     net() const;
 	/**@brief convert to string*/
 	std::string str(bool nomask = false) const;
+
+	/**@brief maximal length of the text form
+	 * ("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff/128")*/
+	static const size_t max_str_len = 43;
+
+	/**@brief write str() to [first, last) without allocations, the result
+	 * is not null-terminated. The longest run of zero groups is compressed,
+	 * IPv4-mapped and compatible addresses end with the dotted quad (the
+	 * same text as inet_ntop).
+	 * @return pointer past the last written char, nullptr if the buffer is
+	 * too small (nothing is written in this case)*/
+	char* to_chars(char* first, char* last, bool nomask = false) const;
+
 	std::string bstr() const { return print_binary(addr_, mask_); }
 	/**@brief check n'th bit, if 1 returns true, false otherwise*/
 	bool check_bit(uint8_t bitno) const;
@@ -67,9 +94,8 @@ namespace std
 
 	inline ostream& operator<<(ostream& strm, const std::array<uint8_t, 16>& addr)
 	{
-		char tmp[50];
-		if (inet_ntop(AF_INET6, addr.data(), tmp, sizeof(tmp)) != NULL)
-			strm << tmp;
+		char tmp[iptools::cidr_v6::max_str_len];
+		strm.write(tmp, iptools::cidr_v6(addr, 128).to_chars(tmp, tmp + sizeof(tmp), true) - tmp);
 		return strm;
 	}
 } // namespace
@@ -79,6 +105,98 @@ namespace std
 
 namespace iptools {
 
+IPTOOLS_CONSTEXPR14 parse_error
+cidr_v6::parse(const char* str, size_t len, cidr_v6& out)
+{
+	if (len == 0)
+		return parse_error::empty;
+	size_t end = 0;
+	while (end < len && str[end] != '/')
+		++end;
+	uint16_t groups[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	int      n   = 0;
+	int      gap = -1; //!< position of "::"
+	size_t   i   = 0;
+	if (end >= 1 && str[0] == ':')
+	{
+		if (end < 2 || str[1] != ':')
+			return parse_error::bad_address;
+		gap = 0;
+		i = 2;
+	}
+	while (i < end)
+	{
+		if (n == 8)
+			return parse_error::bad_address;
+		size_t   first = i;
+		uint32_t value = 0;
+		for (; i < end && i - first < 4; ++i)
+		{
+			char c = str[i];
+			if (c >= '0' && c <= '9')
+				value = value*16 + (c - '0');
+			else if (c >= 'a' && c <= 'f')
+				value = value*16 + (c - 'a' + 10);
+			else if (c >= 'A' && c <= 'F')
+				value = value*16 + (c - 'A' + 10);
+			else
+				break;
+		}
+		if (i < end && str[i] == '.')
+		{
+			// the last 32 bits as dotted quad
+			cidr_v4 v4(0, 0);
+			if (n > 6 || cidr_v4::parse(str + first, end - first, v4) != parse_error::ok)
+				return parse_error::bad_address;
+			groups[n++] = static_cast<uint16_t>((uint32_t)v4 >> 16);
+			groups[n++] = static_cast<uint16_t>((uint32_t)v4 & 0xFFFF);
+			i = end;
+			break;
+		}
+		if (i == first)
+			return parse_error::bad_address;
+		groups[n++] = static_cast<uint16_t>(value);
+		if (i == end)
+			break;
+		if (str[i] != ':' || ++i == end)
+			return parse_error::bad_address;
+		if (str[i] == ':')
+		{
+			if (gap >= 0)
+				return parse_error::bad_address;
+			gap = n;
+			++i;
+		}
+	}
+	if ((gap < 0 && n != 8) || (gap >= 0 && n == 8))
+		return parse_error::bad_address;
+
+	uint8_t mask = 128;
+	if (end < len)
+	{
+		size_t   first = end + 1;
+		uint32_t m     = 0;
+		for (i = first; i < len && i - first < 3 && str[i] >= '0' && str[i] <= '9'; ++i)
+			m = m*10 + (str[i] - '0');
+		if (i == first || i != len || m > 128)
+			return parse_error::bad_mask;
+		mask = static_cast<uint8_t>(m);
+	}
+
+	uint8_t b[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	int tail = gap < 0 ? 0 : n - gap;
+	for (int g = 0; g < n; ++g)
+	{
+		int pos = (gap >= 0 && g >= gap) ? 8 - tail + (g - gap) : g;
+		b[2*pos]     = static_cast<uint8_t>(groups[g] >> 8);
+		b[2*pos + 1] = static_cast<uint8_t>(groups[g] & 0xFF);
+	}
+	out = cidr_v6(std::array<uint8_t, 16>{{b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7],
+	                                        b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]}},
+	              mask);
+	return parse_error::ok;
+}
+
 inline
 cidr_v6::cidr_v6(std::string str)
 {
@@ -111,14 +229,82 @@ cidr_v6::cidr_v6(std::string str)
 inline std::string
 cidr_v6::str(bool nomask) const
 {
-	char tmp[50];
-	if (inet_ntop(AF_INET6, &addr_, tmp, sizeof(tmp)) == NULL)
-		return std::string();
-	if (nomask)
-		return tmp;
-	std::stringstream ss;
-	ss << tmp << "/" << (int)mask_;
-	return ss.str();
+	char tmp[max_str_len];
+	return std::string(tmp, to_chars(tmp, tmp + sizeof(tmp), nomask));
+}
+
+inline char*
+cidr_v6::to_chars(char* first, char* last, bool nomask) const
+{
+	static const char hex[] = "0123456789abcdef";
+	uint16_t words[8];
+	for (int i = 0; i < 8; ++i)
+		words[i] = (uint16_t)(addr_[2*i] << 8 | addr_[2*i + 1]);
+	// the longest run of zero groups (at least two), the first one wins
+	int best = -1, best_len = 0;
+	for (int i = 0; i < 8; )
+	{
+		if (words[i] != 0)
+		{
+			++i;
+			continue;
+		}
+		int j = i;
+		while (j < 8 && words[j] == 0)
+			++j;
+		if (j - i >= 2 && j - i > best_len)
+		{
+			best = i;
+			best_len = j - i;
+		}
+		i = j;
+	}
+	bool dotted = best == 0 && (best_len == 6 || (best_len == 5 && words[5] == 0xFFFF));
+
+	char  tmp[max_str_len];
+	char* p = tmp;
+	for (int i = 0; i < 8; ++i)
+	{
+		if (best >= 0 && i >= best && i < best + best_len)
+		{
+			if (i == best)
+				*p++ = ':';
+			continue;
+		}
+		if (i > 0)
+			*p++ = ':';
+		if (i == 6 && dotted)
+		{
+			uint32_t v4 = (uint32_t)words[6] << 16 | words[7];
+			p = cidr_v4(v4, 32).to_chars(p, p + cidr_v4::max_str_len, true);
+			break;
+		}
+		bool lead = true;
+		for (int shift = 12; shift >= 0; shift -= 4)
+		{
+			unsigned d = (words[i] >> shift) & 0xF;
+			if (lead && d == 0 && shift > 0)
+				continue;
+			lead = false;
+			*p++ = hex[d];
+		}
+	}
+	if (best >= 0 && best + best_len == 8)
+		*p++ = ':';
+	if (!nomask)
+	{
+		unsigned v = mask_;
+		*p++ = '/';
+		if (v >= 100)
+			*p++ = '0' + v/100;
+		if (v >= 10)
+			*p++ = '0' + v/10%10;
+		*p++ = '0' + v%10;
+	}
+	if (p - tmp > last - first)
+		return nullptr;
+	memcpy(first, tmp, p - tmp);
+	return first + (p - tmp);
 }
 
 inline bool
@@ -281,6 +467,8 @@ has_prefix(const std::array<uint8_t, 16>& addr, const std::array<uint8_t, 16>& p
 	for (; i < len/8; i++)
 		if (addr[i] != prefix[i])
 			return false;
+	if (len%8 == 0)
+		return true;
 	uint8_t shift = 8-len%8;
 	return addr[i]>>shift == prefix[i]>>shift;
 }
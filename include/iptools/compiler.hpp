@@ -0,0 +1,74 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 11:02:15 */
+
+#pragma once
+
+#include <cstdint>
+
+/* constexpr for functions with loops and branches, plain inline in C++11*/
+#if __cplusplus >= 201402L
+#define IPTOOLS_CONSTEXPR14 constexpr
+#else
+#define IPTOOLS_CONSTEXPR14 inline
+#endif
+
+#if __cplusplus >= 201703L
+#define IPTOOLS_HAS_STRING_VIEW 1
+#endif
+
+namespace iptools {
+
+/**@brief number of set bits*/
+inline unsigned
+popcount64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_popcountll(v));
+#else
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return static_cast<unsigned>((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**@brief number of trailing zero bits, v should not be 0*/
+inline unsigned
+ctz64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_ctzll(v));
+#else
+	unsigned rs = 0;
+	for (; (v & 1) == 0; v >>= 1)
+		++rs;
+	return rs;
+#endif
+}
+
+/**@brief number of leading zero bits, v should not be 0*/
+inline unsigned
+clz64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_clzll(v));
+#else
+	unsigned rs = 0;
+	for (; (v & 0x8000000000000000ULL) == 0; v <<= 1)
+		++rs;
+	return rs;
+#endif
+}
+
+/**@brief hint the CPU to bring the cache line with addr*/
+inline void
+prefetch(const void* addr)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(addr);
+#else
+	(void)addr;
+#endif
+}
+
+} // namespace
@@ -0,0 +1,313 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 15:41:37 */
+
+#pragma once
+#include "cidr.hpp"
+#include "epoch.hpp"
+#include <atomic>
+#include <vector>
+
+namespace iptools {
+
+/**@brief LPFST with wait-free readers and a single writer
+ *
+ * Published nodes are never changed. insert() and remove() copy the part
+ * of the search path they modify and link it into the tree with a single
+ * atomic store of the child pointer, so a reader sees either the old or
+ * the new tree. Replaced nodes (with their data) are freed through the
+ * epoch_domain when no reader can reach them.
+ *
+ * Every lookup thread gets its own reader (make_reader()) and calls check()
+ * on it. insert(), remove() and clear() should be called by one thread.*/
+template<class T>
+class basic_concurrent_lpfst
+{
+public:
+	class reader;
+
+	/**@param max_readers the number of readers alive at the same time*/
+	explicit basic_concurrent_lpfst(size_t max_readers = 128)
+		: domain_(max_readers)
+	{}
+
+	~basic_concurrent_lpfst() { destroy(root_.load(std::memory_order_relaxed)); }
+
+	basic_concurrent_lpfst(const basic_concurrent_lpfst&) = delete;
+	basic_concurrent_lpfst& operator=(const basic_concurrent_lpfst&) = delete;
+
+	size_t size() const { return size_.load(std::memory_order_relaxed); }
+	bool empty() const { return size() == 0; }
+
+	/**@brief register lookup thread, waits if there are max_readers alive*/
+	reader make_reader() const { return reader(this, domain_.make_reader()); }
+
+	void insert(iptools::cidr_v4 addr, T data);
+	void remove(const iptools::cidr_v4& addr);
+	void clear();
+
+	/**@brief call fun(cidr_v4, const T&) for every stored prefix
+	 * @warning writer thread only*/
+	template<class F> void for_each_prefix(F&& fun) const
+	{
+		std::vector<const node*> stack;
+		if (const node* root = root_.load(std::memory_order_relaxed))
+			stack.push_back(root);
+		while (!stack.empty())
+		{
+			const node* y = stack.back();
+			stack.pop_back();
+			fun(iptools::cidr_v4(y->prefix, y->len), y->data);
+			for (int i = 1; i >= 0; --i)
+				if (const node* c = y->child[i].load(std::memory_order_relaxed))
+					stack.push_back(c);
+		}
+	}
+
+protected:
+	struct node
+	{
+		node(uint8_t len, uint32_t prefix, const T& data)
+			: len(len)
+			, prefix(prefix)
+			, data(data)
+		{
+			child[0].store(nullptr, std::memory_order_relaxed);
+			child[1].store(nullptr, std::memory_order_relaxed);
+		}
+
+		/**@brief unpublished copy with the same children*/
+		node* clone() const
+		{
+			node* rs = new node(len, prefix, data);
+			rs->child[0].store(child[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			rs->child[1].store(child[1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			return rs;
+		}
+
+		uint8_t            len;
+		uint32_t           prefix;
+		T                  data;
+		std::atomic<node*> child[2];
+	};
+
+	static uint8_t len(const iptools::cidr_v4& addr) { return addr.is_net() ? addr.mask() : 32; }
+	static uint32_t mask(uint8_t len) { return len == 0 ? 0 : ~0U << (32 - len); }
+	static uint8_t bit(uint32_t addr, uint8_t level) { return ((uint64_t)addr << level >> 31) & 1; }
+
+	node* load(const std::atomic<node*>& link) const { return link.load(std::memory_order_relaxed); }
+
+	/**@brief copy the published node for modification, the original is retired*/
+	node* copy(node* from)
+	{
+		domain_.retire(from);
+		return from->clone();
+	}
+
+	static void destroy(node* root);
+
+	std::atomic<node*>   root_{nullptr};
+	std::atomic<size_t>  size_{0};
+	mutable epoch_domain domain_;
+};
+
+/**@brief Lookup side of the basic_concurrent_lpfst, one per thread*/
+template<class T>
+class basic_concurrent_lpfst<T>::reader
+{
+public:
+	reader() {}
+
+	/**@return true if the address belongs any of the inserted CIDRs*/
+	bool check(const iptools::cidr_v4& addr, T& data)
+	{
+		epoch_domain::guard guard(reader_);
+		const node* y = table_->root_.load(std::memory_order_acquire);
+		bool     is_net = addr.is_net();
+		uint32_t addr_i = (uint32_t)addr;
+		uint8_t  mask   = addr.mask();
+		for (uint8_t level = 0; y != nullptr; ++level)
+		{
+			if (is_net && mask < level)
+				return true;
+			if (!is_net || mask >= y->len)
+			{
+				if ((addr_i & basic_concurrent_lpfst::mask(y->len)) == y->prefix)
+				{
+					data = y->data;
+					return true;
+				}
+			}
+			y = y->child[bit(addr_i, level)].load(std::memory_order_acquire);
+		}
+		return false;
+	}
+
+	/**@return true if the address belongs any of the inserted CIDRs
+	 * @param addr in host byte order*/
+	bool check(const uint32_t addr, T& data)
+	{
+		epoch_domain::guard guard(reader_);
+		const node* y = table_->root_.load(std::memory_order_acquire);
+		for (uint8_t level = 0; y != nullptr; ++level)
+		{
+			if ((addr & basic_concurrent_lpfst::mask(y->len)) == y->prefix)
+			{
+				data = y->data;
+				return true;
+			}
+			y = y->child[bit(addr, level)].load(std::memory_order_acquire);
+		}
+		return false;
+	}
+
+private:
+	reader(const basic_concurrent_lpfst* table, epoch_domain::reader&& r)
+		: table_(table)
+		, reader_(std::move(r))
+	{}
+
+	const basic_concurrent_lpfst* table_{nullptr};
+	epoch_domain::reader          reader_;
+
+friend class basic_concurrent_lpfst;
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class T> void
+basic_concurrent_lpfst<T>::insert(iptools::cidr_v4 addr, T data)
+{
+	// find the first node the insertion changes
+	std::atomic<node*>* link = &root_;
+	node*   y = load(*link);
+	uint8_t level = 0;
+	for (; y != nullptr && len(addr) < y->len; ++level)
+	{
+		if (len(addr) == level)
+			return;
+		link = &y->child[bit(addr, level)];
+		y = load(*link);
+	}
+	if (y == nullptr)
+	{
+		link->store(new node(len(addr), addr, data), std::memory_order_release);
+		size_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	// the rest of the path is built on copies and published at once
+	node* top = copy(y);
+	for (y = top; ; ++level)
+	{
+		if (len(addr) >= y->len)
+		{
+			iptools::cidr_v4 aux(y->prefix, y->len);
+			std::swap(y->data, data);
+			y->len = len(addr);
+			y->prefix = addr;
+			addr = aux;
+		}
+		if (len(addr) == y->len && ((uint32_t)addr & mask(y->len)) == (y->prefix & mask(y->len)))
+			break;
+		if (len(addr) == level)
+			break;
+		std::atomic<node*>& next = y->child[bit(addr, level)];
+		if (load(next) == nullptr)
+		{
+			next.store(new node(len(addr), addr, data), std::memory_order_relaxed);
+			size_.fetch_add(1, std::memory_order_relaxed);
+			break;
+		}
+		node* c = copy(load(next));
+		next.store(c, std::memory_order_relaxed);
+		y = c;
+	}
+	link->store(top, std::memory_order_release);
+	domain_.synchronize();
+}
+
+template<class T> void
+basic_concurrent_lpfst<T>::remove(const iptools::cidr_v4& toremove)
+{
+	std::atomic<node*>* link = &root_;
+	node* y = load(*link);
+	for (uint8_t level = 0; y != nullptr; ++level)
+	{
+		if (y->len == len(toremove) && y->prefix == ((uint32_t)toremove & mask(y->len)))
+			break;
+		if (len(toremove) == level)
+			return;
+		link = &y->child[bit(toremove, level)];
+		y = load(*link);
+	}
+	if (y == nullptr)
+		return;
+	size_.fetch_sub(1, std::memory_order_relaxed);
+	// pull the longest child up until the leaf is reached, on copies
+	node* top = nullptr;
+	std::atomic<node*>* ylink = nullptr; // link to y inside the new path
+	for (;;)
+	{
+		node* l = load(y->child[0]);
+		node* r = load(y->child[1]);
+		if (l == nullptr && r == nullptr)
+		{
+			domain_.retire(y);
+			if (ylink)
+				ylink->store(nullptr, std::memory_order_relaxed);
+			break;
+		}
+		int   side = (r == nullptr || (l != nullptr && l->len > r->len)) ? 0 : 1;
+		node* c    = side == 0 ? l : r;
+		node* up   = new node(c->len, c->prefix, c->data);
+		up->child[0].store(l, std::memory_order_relaxed);
+		up->child[1].store(r, std::memory_order_relaxed);
+		domain_.retire(y);
+		if (ylink)
+			ylink->store(up, std::memory_order_relaxed);
+		else
+			top = up;
+		ylink = &up->child[side];
+		y = c;
+	}
+	link->store(top, std::memory_order_release);
+	domain_.synchronize();
+}
+
+template<class T> void
+basic_concurrent_lpfst<T>::clear()
+{
+	std::vector<node*> stack;
+	if (node* root = root_.exchange(nullptr, std::memory_order_acq_rel))
+		stack.push_back(root);
+	while (!stack.empty())
+	{
+		node* y = stack.back();
+		stack.pop_back();
+		for (auto& c : y->child)
+			if (node* n = load(c))
+				stack.push_back(n);
+		domain_.retire(y);
+	}
+	size_.store(0, std::memory_order_relaxed);
+	domain_.synchronize();
+}
+
+template<class T> void
+basic_concurrent_lpfst<T>::destroy(node* root)
+{
+	std::vector<node*> stack;
+	if (root)
+		stack.push_back(root);
+	while (!stack.empty())
+	{
+		node* y = stack.back();
+		stack.pop_back();
+		for (auto& c : y->child)
+			if (node* n = c.load(std::memory_order_relaxed))
+				stack.push_back(n);
+		delete y;
+	}
+}
+
+} // namespace
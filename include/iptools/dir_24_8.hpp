@@ -0,0 +1,278 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 10:12:40 */
+
+#pragma once
+#include "lpfst.hpp"
+#include "simd.hpp"
+#include <vector>
+#include <unordered_map>
+
+namespace iptools {
+
+/**@brief DIR-24-8 direct lookup table for IPv4
+ *
+ * The first level is indexed by the upper 24 bits of the address, prefixes
+ * longer than /24 are expanded into 256-entry second level blocks, so every
+ * lookup costs one or two memory accesses. Insert and remove patch only
+ * the table ranges covered by the prefix.
+ *
+ * @warning up to 2^25-1 prefixes and 2^23 second level blocks*/
+template<class T>
+class basic_dir_24_8
+{
+public:
+	basic_dir_24_8() {}
+
+	template<class Alloc, class Instr>
+	explicit basic_dir_24_8(const basic_lpfst<T, Alloc, Instr>& from)
+	{
+		from.for_each_prefix([this](const iptools::cidr_v4& addr, const T& data)
+			{
+				insert(addr, data);
+			});
+	}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	void insert(iptools::cidr_v4 addr, T data);
+	void remove(const iptools::cidr_v4& addr);
+
+	/**@return true if the address belongs any of the inserted CIDRs
+	 * @param addr in host byte order*/
+	bool check(const uint32_t addr, T& data) const
+	{
+		if (tbl24_.empty())
+			return false;
+		uint32_t e = tbl24_[addr >> 8];
+		if (e & EXT_FLAG)
+			e = tbl8_[((e & ~EXT_FLAG) << 8) | (addr & 0xFF)];
+		uint32_t idx = e & VALUE_MASK;
+		if (idx == 0)
+			return false;
+		data = values_[idx];
+		return true;
+	}
+
+	/**@brief check n addresses (host byte order) at once
+	 *
+	 * Table entries are fetched with vector gathers (AVX-512 - 16, AVX2 - 8
+	 * addresses per iteration) with the scalar fallback giving the same
+	 * results.
+	 * @param found found[i] is set to 1 if addrs[i] belongs any of the
+	 * inserted CIDRs (out[i] is assigned only in this case), 0 otherwise
+	 * @param level the kernel to use, limited to the best supported one*/
+	void check_batch(const uint32_t* addrs, size_t n, T* out, uint8_t* found,
+	                 simd_level level = simd_detect()) const
+	{
+		if (tbl24_.empty())
+		{
+			std::fill(found, found + n, 0);
+			return;
+		}
+		const size_t chunk = 256;
+		uint32_t entries[chunk];
+		for (size_t base = 0; base < n; base += chunk)
+		{
+			size_t cnt = n - base < chunk ? n - base : chunk;
+			dir_24_8_lookup(tbl24_.data(), tbl8_.data(), addrs + base, cnt, entries, level);
+			for (size_t i = 0; i < cnt; ++i)
+			{
+				uint32_t idx = entries[i] & VALUE_MASK;
+				found[base + i] = idx != 0;
+				if (idx != 0)
+					out[base + i] = values_[idx];
+			}
+		}
+	}
+
+	void clear();
+
+	/**@brief approximate number of bytes used by the tables and data*/
+	size_t memory_footprint() const;
+
+protected:
+	/* Entry layout: [ext:1][len:6][value:25]. If ext is set (first level
+	 * only) the rest is the second level block number. Value 0 means no
+	 * route.*/
+	static const uint32_t EXT_FLAG   = 1U << 31;
+	static const uint32_t VALUE_MASK = (1U << 25) - 1;
+	static const uint8_t  LEN_SHIFT  = 25;
+
+	static uint32_t entry(uint32_t value, uint8_t len) { return ((uint32_t)len << LEN_SHIFT) | value; }
+	static uint8_t entry_len(uint32_t e) { return (e >> LEN_SHIFT) & 0x3F; }
+	static uint32_t net(uint32_t addr, uint8_t len) { return len == 0 ? 0 : addr >> (32 - len) << (32 - len); }
+
+	template<class C> void fill(uint32_t prefix, uint8_t len, uint32_t value, C cond);
+	uint32_t alloc_block(uint32_t init);
+
+	std::vector<uint32_t> tbl24_;
+	std::vector<uint32_t> tbl8_;
+	std::vector<uint32_t> free_blocks_;
+	std::vector<T>        values_;
+	std::vector<uint32_t> free_values_;
+	std::unordered_map<uint32_t, uint32_t> routes_[33]; //!< prefix -> value for every length
+	size_t size_{0};
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class T> void
+basic_dir_24_8<T>::insert(iptools::cidr_v4 addr, T data)
+{
+	uint8_t  len    = addr.is_net() ? addr.mask() : 32;
+	uint32_t prefix = net(addr, len);
+	auto found = routes_[len].find(prefix);
+	if (found != routes_[len].end())
+	{
+		values_[found->second] = data;
+		return;
+	}
+	if (tbl24_.empty())
+	{
+		tbl24_.assign(1U << 24, 0);
+		values_.resize(1);
+	}
+	uint32_t value;
+	if (!free_values_.empty())
+	{
+		value = free_values_.back();
+		free_values_.pop_back();
+		values_[value] = data;
+	}
+	else
+	{
+		value = static_cast<uint32_t>(values_.size());
+		values_.push_back(data);
+	}
+	routes_[len][prefix] = value;
+	++size_;
+	fill(prefix, len, entry(value, len),
+		[len](uint32_t e) { return entry_len(e) <= len; });
+}
+
+template<class T> void
+basic_dir_24_8<T>::remove(const iptools::cidr_v4& addr)
+{
+	uint8_t  len    = addr.is_net() ? addr.mask() : 32;
+	uint32_t prefix = net(addr, len);
+	auto found = routes_[len].find(prefix);
+	if (found == routes_[len].end())
+		return;
+	uint32_t value = found->second;
+	routes_[len].erase(found);
+	values_[value] = T();
+	free_values_.push_back(value);
+	--size_;
+
+	uint32_t replace = 0;
+	for (uint8_t l = len; l-- > 0; )
+	{
+		auto cover = routes_[l].find(net(prefix, l));
+		if (cover != routes_[l].end())
+		{
+			replace = entry(cover->second, l);
+			break;
+		}
+	}
+	fill(prefix, len, replace,
+		[value](uint32_t e) { return (e & VALUE_MASK) == value; });
+
+	if (len <= 24)
+		return;
+	// release the second level block if nothing longer than /24 left in it
+	uint32_t& e24 = tbl24_[prefix >> 8];
+	uint32_t  blk = e24 & ~EXT_FLAG;
+	for (uint32_t i = blk << 8; i < (blk + 1) << 8; ++i)
+		if (entry_len(tbl8_[i]) > 24)
+			return;
+	e24 = tbl8_[blk << 8];
+	free_blocks_.push_back(blk);
+}
+
+template<class T> void
+basic_dir_24_8<T>::clear()
+{
+	tbl24_.clear();
+	tbl24_.shrink_to_fit();
+	tbl8_.clear();
+	tbl8_.shrink_to_fit();
+	free_blocks_.clear();
+	values_.clear();
+	free_values_.clear();
+	for (auto& r : routes_)
+		r.clear();
+	size_ = 0;
+}
+
+template<class T> size_t
+basic_dir_24_8<T>::memory_footprint() const
+{
+	size_t rs = sizeof(*this);
+	rs += tbl24_.capacity()*sizeof(uint32_t);
+	rs += tbl8_.capacity()*sizeof(uint32_t);
+	rs += free_blocks_.capacity()*sizeof(uint32_t);
+	rs += values_.capacity()*sizeof(T);
+	rs += free_values_.capacity()*sizeof(uint32_t);
+	for (const auto& r : routes_)
+	{
+		rs += r.bucket_count()*sizeof(void*);
+		rs += r.size()*(sizeof(std::pair<const uint32_t, uint32_t>) + sizeof(void*));
+	}
+	return rs;
+}
+
+template<class T> template<class C> void
+basic_dir_24_8<T>::fill(uint32_t prefix, uint8_t len, uint32_t value, C cond)
+{
+	if (len <= 24)
+	{
+		uint32_t first = prefix >> 8;
+		uint32_t last  = first + (1U << (24 - len));
+		for (uint32_t i = first; i < last; ++i)
+		{
+			uint32_t& e = tbl24_[i];
+			if (e & EXT_FLAG)
+			{
+				uint32_t blk = e & ~EXT_FLAG;
+				for (uint32_t j = blk << 8; j < (blk + 1) << 8; ++j)
+					if (cond(tbl8_[j]))
+						tbl8_[j] = value;
+			}
+			else if (cond(e))
+			{
+				e = value;
+			}
+		}
+		return;
+	}
+	uint32_t& e24 = tbl24_[prefix >> 8];
+	if (!(e24 & EXT_FLAG))
+		e24 = EXT_FLAG | alloc_block(e24);
+	uint32_t first = ((e24 & ~EXT_FLAG) << 8) | (prefix & 0xFF);
+	uint32_t last  = first + (1U << (32 - len));
+	for (uint32_t j = first; j < last; ++j)
+		if (cond(tbl8_[j]))
+			tbl8_[j] = value;
+}
+
+template<class T> uint32_t
+basic_dir_24_8<T>::alloc_block(uint32_t init)
+{
+	uint32_t blk;
+	if (!free_blocks_.empty())
+	{
+		blk = free_blocks_.back();
+		free_blocks_.pop_back();
+	}
+	else
+	{
+		blk = static_cast<uint32_t>(tbl8_.size() >> 8);
+		tbl8_.resize(tbl8_.size() + 256);
+	}
+	std::fill(tbl8_.begin() + (blk << 8), tbl8_.begin() + ((blk + 1) << 8), init);
+	return blk;
+}
+
+} // namespace
@@ -0,0 +1,203 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 15:20:11 */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstdint>
+
+namespace iptools {
+
+/**@brief Epoch based reclamation for one writer and many readers
+ *
+ * Every reader thread owns a reader handle (slot). Entering and leaving
+ * the read side costs one store each and never waits. The writer retires
+ * unlinked objects and frees them in synchronize() as soon as no reader
+ * which could see them is inside the read side.
+ *
+ * @warning retire() and synchronize() should be called by one thread*/
+class epoch_domain
+{
+	struct slot;
+
+public:
+	class reader;
+	class guard;
+
+	explicit epoch_domain(size_t max_readers = 128)
+		: storage_(new unsigned char[max_readers*sizeof(slot) + line - 1])
+		, slots_count_(max_readers)
+	{
+		// new doesn't honour the slot alignment before C++17
+		slots_ = reinterpret_cast<slot*>(
+			(reinterpret_cast<uintptr_t>(storage_.get()) + line - 1) & ~(uintptr_t)(line - 1));
+		for (size_t i = 0; i < slots_count_; ++i)
+			new (slots_ + i) slot();
+	}
+
+	~epoch_domain()
+	{
+		reclaim(~0ULL);
+		for (size_t i = 0; i < slots_count_; ++i)
+			slots_[i].~slot();
+	}
+
+	epoch_domain(const epoch_domain&) = delete;
+	epoch_domain& operator=(const epoch_domain&) = delete;
+
+	/**@brief register reader, waits if all the slots are taken*/
+	reader make_reader();
+
+	/**@brief free p with deleter when readers can't see it anymore*/
+	void retire(void* p, void (*deleter)(void*))
+	{
+		retired_.push_back({epoch_.load(std::memory_order_relaxed), p, deleter});
+	}
+
+	template<class O> void retire(O* p)
+	{
+		retire(p, [](void* o) { delete static_cast<O*>(o); });
+	}
+
+	/**@brief advance the epoch and free retired objects no reader can see*/
+	void synchronize()
+	{
+		uint64_t cur = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+		uint64_t min = cur;
+		for (size_t i = 0; i < slots_count_; ++i)
+		{
+			uint64_t e = slots_[i].epoch.load(std::memory_order_seq_cst);
+			if (e < min)
+				min = e;
+		}
+		reclaim(min);
+	}
+
+	/**@brief number of retired but not yet freed objects*/
+	size_t pending() const { return retired_.size(); }
+
+private:
+	static const uint64_t IDLE = ~0ULL;
+	static const size_t   line = 64;
+
+	/**@brief one per cache line, readers don't share lines*/
+	struct alignas(line) slot
+	{
+		std::atomic<uint64_t> epoch{IDLE};
+		std::atomic<bool>     used{false};
+	};
+
+	struct retired
+	{
+		uint64_t epoch;
+		void*    ptr;
+		void   (*deleter)(void*);
+	};
+
+	/**@brief free everything retired before the epoch*/
+	void reclaim(uint64_t epoch)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < retired_.size(); ++i)
+		{
+			if (retired_[i].epoch < epoch)
+				retired_[i].deleter(retired_[i].ptr);
+			else
+				retired_[kept++] = retired_[i];
+		}
+		retired_.resize(kept);
+	}
+
+	std::unique_ptr<unsigned char[]> storage_;
+	slot*                            slots_{nullptr}; //!< line aligned in storage_
+	size_t                           slots_count_;
+	std::atomic<uint64_t>            epoch_{0};
+	std::vector<retired>             retired_;
+};
+
+/**@brief Reader slot, should be used by one thread at a time*/
+class epoch_domain::reader
+{
+public:
+	reader() {}
+	reader(reader&& rhv) : domain_(rhv.domain_), slot_(rhv.slot_) { rhv.slot_ = nullptr; }
+	reader& operator=(reader&& rhv)
+	{
+		release();
+		domain_ = rhv.domain_;
+		slot_ = rhv.slot_;
+		rhv.slot_ = nullptr;
+		return *this;
+	}
+	~reader() { release(); }
+
+	/**@brief objects reachable after enter() are not freed until leave()*/
+	void enter()
+	{
+		slot_->epoch.store(domain_->epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+
+	void leave()
+	{
+		slot_->epoch.store(IDLE, std::memory_order_release);
+	}
+
+private:
+	reader(epoch_domain* domain, slot* s) : domain_(domain), slot_(s) {}
+
+	void release()
+	{
+		if (!slot_)
+			return;
+		slot_->epoch.store(IDLE, std::memory_order_release);
+		slot_->used.store(false, std::memory_order_release);
+		slot_ = nullptr;
+	}
+
+	epoch_domain* domain_{nullptr};
+	slot*         slot_{nullptr};
+
+friend class epoch_domain;
+};
+
+/**@brief RAII read side section*/
+class epoch_domain::guard
+{
+public:
+	explicit guard(reader& r) : reader_(r) { reader_.enter(); }
+	~guard() { reader_.leave(); }
+
+	guard(const guard&) = delete;
+	guard& operator=(const guard&) = delete;
+
+private:
+	reader& reader_;
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+inline epoch_domain::reader
+epoch_domain::make_reader()
+{
+	for (;;)
+	{
+		for (size_t i = 0; i < slots_count_; ++i)
+		{
+			bool expected = false;
+			if (!slots_[i].used.load(std::memory_order_relaxed)
+			    && slots_[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+			{
+				return reader(this, &slots_[i]);
+			}
+		}
+		std::this_thread::yield();
+	}
+}
+
+} // namespace
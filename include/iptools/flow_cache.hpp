@@ -0,0 +1,167 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 00:52:13 */
+
+#pragma once
+#include "lpfst.hpp"
+#include "lpfst_v6.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace iptools {
+
+/**@brief Key operations needed by the flow cache*/
+template<class Key> struct flow_key;
+
+template<> struct flow_key<uint32_t>
+{
+	static uint32_t hash(uint32_t key)
+	{
+		return static_cast<uint32_t>((key*0x9E3779B97F4A7C15ULL) >> 32);
+	}
+};
+
+template<> struct flow_key<in6_addr_t>
+{
+	static uint32_t hash(const in6_addr_t& key)
+	{
+		uint64_t hi, lo;
+		memcpy(&hi, key.data(), 8);
+		memcpy(&lo, key.data() + 8, 8);
+		return static_cast<uint32_t>(((hi ^ lo*0xC2B2AE3D27D4EB4FULL)*0x9E3779B97F4A7C15ULL) >> 32);
+	}
+};
+
+/**@brief Set-associative cache of the lookup results in front of the table
+ *
+ * Keeps the recent addresses with their result (the data or "not found")
+ * in sets of one cache line, so a repeated lookup reads one line and
+ * never touches the table. The cache is not thread-safe, take one per
+ * lookup thread.
+ *
+ * Entries are tagged with the cache epoch, it is advanced when the table
+ * generation() changes, so invalidation after insert/remove is O(1). The
+ * table should outlive the cache.
+ *
+ * Table is basic_lpfst (Key is uint32_t in host byte order) or
+ * basic_lpfst_v6 (Key is in6_addr_t), T should be copy assignable.*/
+template<class Key, class Table>
+class flow_cache
+{
+public:
+	using value_type = typename Table::value_type;
+
+	/**@param capacity entries, rounded up to whole power of two sets*/
+	explicit flow_cache(const Table& table, size_t capacity = 4096)
+		: table_(&table)
+	{
+		size_t sets = 1;
+		while (sets*ways < capacity)
+			sets <<= 1;
+		mask_ = static_cast<uint32_t>(sets - 1);
+		storage_.reset(new unsigned char[sets*sizeof(set) + line - 1]);
+		sets_ = reinterpret_cast<set*>(
+			(reinterpret_cast<uintptr_t>(storage_.get()) + line - 1) & ~(uintptr_t)(line - 1));
+		for (size_t i = 0; i < sets; ++i)
+			new (sets_ + i) set();
+	}
+
+	~flow_cache()
+	{
+		for (size_t i = 0; i <= mask_; ++i)
+			sets_[i].~set();
+	}
+
+	flow_cache(const flow_cache&) = delete;
+	flow_cache& operator=(const flow_cache&) = delete;
+
+	/**@brief table check() through the cache*/
+	bool check(const Key& addr, value_type& data)
+	{
+		uint64_t generation = table_->generation();
+		if (generation != generation_)
+		{
+			generation_ = generation;
+			if (++epoch_ == 0)
+				reset();
+		}
+		set& s = sets_[flow_key<Key>::hash(addr) & mask_];
+		for (size_t i = 0; i < ways; ++i)
+		{
+			const entry& e = s.entries[i];
+			if (e.epoch == epoch_ && e.key == addr)
+			{
+				++hits_;
+				if (e.found)
+					data = e.data;
+				return e.found;
+			}
+		}
+		++misses_;
+		entry* victim = nullptr;
+		for (size_t i = 0; i < ways && !victim; ++i)
+			if (s.entries[i].epoch != epoch_)
+				victim = &s.entries[i];
+		if (!victim)
+			victim = &s.entries[next_++ % ways];
+		const value_type* rs = table_->find(addr);
+		victim->key   = addr;
+		victim->epoch = epoch_;
+		victim->found = rs != nullptr;
+		if (!rs)
+			return false;
+		victim->data = *rs;
+		data = *rs;
+		return true;
+	}
+
+	/**@brief forget all the entries*/
+	void reset()
+	{
+		for (size_t i = 0; i <= mask_; ++i)
+			for (size_t j = 0; j < ways; ++j)
+				sets_[i].entries[j].epoch = 0;
+		epoch_ = 1;
+	}
+
+	size_t capacity() const { return (mask_ + 1)*ways; }
+	uint64_t hits() const { return hits_; }
+	uint64_t misses() const { return misses_; }
+
+private:
+	static const size_t line = 64;
+
+	struct entry
+	{
+		Key        key{};
+		uint32_t   epoch{0}; //!< valid if equal to the cache epoch_
+		bool       found{false};
+		value_type data{};
+	};
+
+	/**@brief entries in one set, as many as fit into the cache line*/
+	static const size_t ways = sizeof(entry) < line ? line/sizeof(entry) : 1;
+
+	struct alignas(line) set
+	{
+		entry entries[ways];
+	};
+
+	const Table*                     table_;
+	std::unique_ptr<unsigned char[]> storage_;
+	set*                             sets_{nullptr}; //!< line aligned in storage_
+	uint32_t                         mask_{0};
+	uint32_t                         epoch_{1};
+	uint64_t                         generation_{0};
+	size_t                           next_{0}; //!< round robin victim
+	uint64_t                         hits_{0};
+	uint64_t                         misses_{0};
+};
+
+template<class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+using lpfst_flow_cache = flow_cache<uint32_t, basic_lpfst<T, Alloc, Instr> >;
+template<class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+using lpfst_v6_flow_cache = flow_cache<in6_addr_t, basic_lpfst_v6<T, Alloc, Instr> >;
+
+} // namespace
@@ -0,0 +1,267 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 22:03:16 */
+
+#pragma once
+#include "cidr.hpp"
+#include "lpfst_v6.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace iptools {
+
+/**@brief shape of the generated prefix set*/
+struct prefix_profile
+{
+	/**@brief (prefix length, weight) histogram*/
+	std::vector<std::pair<uint8_t, double> > lengths;
+	/**@brief share of prefixes generated inside a shorter one already in
+	 * the set, gives the nesting of the real tables*/
+	double nested{0};
+
+	/**@brief approximate shape of the public IPv4 routing table*/
+	static prefix_profile bgp_v4()
+	{
+		prefix_profile rs;
+		rs.lengths = {{8, 16}, {9, 13}, {10, 37}, {11, 100}, {12, 300}, {13, 600},
+		              {14, 1100}, {15, 1900}, {16, 13500}, {17, 8000}, {18, 13500},
+		              {19, 25000}, {20, 45000}, {21, 55000}, {22, 120000},
+		              {23, 140000}, {24, 590000}};
+		rs.nested = 0.5;
+		return rs;
+	}
+
+	/**@brief approximate shape of the public IPv6 routing table*/
+	static prefix_profile bgp_v6()
+	{
+		prefix_profile rs;
+		rs.lengths = {{19, 50}, {20, 100}, {24, 300}, {28, 600}, {29, 4000}, {32, 30000},
+		              {33, 2500}, {34, 1500}, {35, 1000}, {36, 8000}, {40, 12000},
+		              {44, 20000}, {46, 8000}, {47, 4000}, {48, 110000}, {56, 2000},
+		              {64, 1000}};
+		rs.nested = 0.4;
+		return rs;
+	}
+};
+
+/**@brief shape of the generated address trace*/
+struct trace_profile
+{
+	double hit_ratio{1}; //!< share of addresses belonging to the prefixes
+	double zipf{0};      //!< Zipf exponent of the prefix popularity, 0 - uniform
+	/**@brief number of distinct addresses (flows) repeated with the Zipf
+	 * popularity over the whole trace, 0 - every address is drawn anew*/
+	size_t flows{0};
+};
+
+/* Generators use only raw mt19937 output (no std distributions), so the
+ * same seed gives the same data with every standard library.*/
+
+/**@brief uniform in [0, 1)*/
+inline double
+generator_uniform(std::mt19937& rng)
+{
+	return rng()/4294967296.0;
+}
+
+/**@brief index in the cumulative weights*/
+inline size_t
+generator_pick(const std::vector<double>& cdf, std::mt19937& rng)
+{
+	size_t rs = std::upper_bound(cdf.begin(), cdf.end(), generator_uniform(rng)*cdf.back()) - cdf.begin();
+	return rs < cdf.size() ? rs : cdf.size() - 1;
+}
+
+inline std::vector<double>
+generator_length_cdf(const prefix_profile& profile)
+{
+	std::vector<double> rs;
+	double sum = 0;
+	for (const auto& l : profile.lengths)
+		rs.push_back(sum += l.second);
+	return rs;
+}
+
+/**@brief replace the first len bits of addr with the ones of prefix*/
+inline void
+generator_copy_bits(in6_addr_t& addr, const in6_addr_t& prefix, uint8_t len)
+{
+	for (uint8_t i = 0; i < 16 && len > 0; ++i, len = len > 8 ? len - 8 : 0)
+	{
+		uint8_t m = static_cast<uint8_t>(len >= 8 ? 0xFF : 0xFF00 >> len);
+		addr[i] = static_cast<uint8_t>((addr[i] & ~m) | (prefix[i] & m));
+	}
+}
+
+/**@brief prefix popularity, the prefix i has the weight 1/(i+1)^s*/
+inline std::vector<double>
+generator_zipf_cdf(size_t n, double s)
+{
+	std::vector<double> rs(n);
+	double sum = 0;
+	for (size_t i = 0; i < n; ++i)
+		rs[i] = (sum += s == 0 ? 1 : 1/std::pow((double)(i + 1), s));
+	return rs;
+}
+
+/**@brief n unique IPv4 prefixes inside 1.0.0.0 - 223.255.255.255
+ *
+ * The result is deterministic for the seed. The profile should allow n
+ * unique prefixes in this space.*/
+inline std::vector<iptools::cidr_v4>
+generate_prefixes_v4(size_t n, uint32_t seed = 1, const prefix_profile& profile = prefix_profile::bgp_v4())
+{
+	std::mt19937 rng(seed);
+	std::vector<double> cdf = generator_length_cdf(profile);
+	std::unordered_set<uint64_t> seen;
+	std::vector<iptools::cidr_v4> rs;
+	rs.reserve(n);
+	while (rs.size() < n && !cdf.empty())
+	{
+		uint8_t  len  = profile.lengths[generator_pick(cdf, rng)].first;
+		uint32_t addr = (1 + rng() % 223) << 24 | (rng() & 0xFFFFFF);
+		if (!rs.empty() && generator_uniform(rng) < profile.nested)
+		{
+			for (int attempt = 0; attempt < 4; ++attempt)
+			{
+				const iptools::cidr_v4& parent = rs[rng() % rs.size()];
+				if (parent.mask() < len)
+				{
+					addr = parent.first() | (addr & (0xFFFFFFFFU >> parent.mask()));
+					break;
+				}
+			}
+		}
+		addr = len == 0 ? 0 : addr >> (32 - len) << (32 - len);
+		if (seen.insert((uint64_t)addr << 8 | len).second)
+			rs.emplace_back(addr, len);
+	}
+	return rs;
+}
+
+/**@brief n unique IPv6 prefixes inside 2000::/3, see generate_prefixes_v4*/
+inline std::vector<iptools::cidr_v6>
+generate_prefixes_v6(size_t n, uint32_t seed = 1, const prefix_profile& profile = prefix_profile::bgp_v6())
+{
+	std::mt19937 rng(seed);
+	std::vector<double> cdf = generator_length_cdf(profile);
+	std::set<std::pair<in6_addr_t, uint8_t> > seen;
+	std::vector<iptools::cidr_v6> rs;
+	rs.reserve(n);
+	while (rs.size() < n && !cdf.empty())
+	{
+		uint8_t    len = profile.lengths[generator_pick(cdf, rng)].first;
+		in6_addr_t addr;
+		for (auto& b : addr)
+			b = static_cast<uint8_t>(rng());
+		addr[0] = 0x20 | (addr[0] & 0x1F);
+		if (!rs.empty() && generator_uniform(rng) < profile.nested)
+		{
+			for (int attempt = 0; attempt < 4; ++attempt)
+			{
+				const iptools::cidr_v6& parent = rs[rng() % rs.size()];
+				if (parent.mask() < len)
+				{
+					generator_copy_bits(addr, parent, parent.mask());
+					break;
+				}
+			}
+		}
+		iptools::cidr_v6 prefix = iptools::cidr_v6(addr, len).net();
+		if (seen.insert(std::make_pair(in6_addr_t(prefix), len)).second)
+			rs.push_back(prefix);
+	}
+	return rs;
+}
+
+/**@brief draw the trace of n from profile.flows addresses generated by
+ * gen(flows, profile without flows)*/
+template<class Addr, class Gen> std::vector<Addr>
+generator_flows(size_t n, uint32_t seed, const trace_profile& profile, Gen gen)
+{
+	trace_profile once = profile;
+	once.flows = 0;
+	std::vector<Addr> flows = gen(profile.flows, once);
+	std::mt19937 rng(seed ^ 0x5BD1E995);
+	std::vector<double> cdf = generator_zipf_cdf(flows.size(), profile.zipf);
+	std::vector<Addr> rs;
+	rs.reserve(n);
+	for (size_t i = 0; i < n && !flows.empty(); ++i)
+		rs.push_back(flows[generator_pick(cdf, rng)]);
+	return rs;
+}
+
+/**@brief n addresses (host byte order) for check(uint32_t)
+ *
+ * Hits are random hosts of the prefixes chosen with the Zipf popularity,
+ * misses are taken from 224.0.0.0/3 which generate_prefixes_v4 never
+ * covers.*/
+inline std::vector<uint32_t>
+generate_trace_v4(const std::vector<iptools::cidr_v4>& prefixes, size_t n, uint32_t seed = 2,
+                  const trace_profile& profile = trace_profile())
+{
+	if (profile.flows > 0)
+	{
+		return generator_flows<uint32_t>(n, seed, profile, [&](size_t flows, const trace_profile& once)
+			{
+				return generate_trace_v4(prefixes, flows, seed, once);
+			});
+	}
+	std::mt19937 rng(seed);
+	std::vector<double> cdf = generator_zipf_cdf(prefixes.size(), profile.zipf);
+	std::vector<uint32_t> rs;
+	rs.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint32_t host = rng();
+		if (prefixes.empty() || generator_uniform(rng) >= profile.hit_ratio)
+		{
+			rs.push_back(0xE0000000U | (host & 0x1FFFFFFF));
+			continue;
+		}
+		const iptools::cidr_v4& p = prefixes[generator_pick(cdf, rng)];
+		rs.push_back(p.first() | (p.mask() == 32 ? 0 : host & (0xFFFFFFFFU >> p.mask())));
+	}
+	return rs;
+}
+
+/**@brief n addresses for check(in6_addr_t), misses are taken from fd00::/8
+ * which generate_prefixes_v6 never covers*/
+inline std::vector<in6_addr_t>
+generate_trace_v6(const std::vector<iptools::cidr_v6>& prefixes, size_t n, uint32_t seed = 2,
+                  const trace_profile& profile = trace_profile())
+{
+	if (profile.flows > 0)
+	{
+		return generator_flows<in6_addr_t>(n, seed, profile, [&](size_t flows, const trace_profile& once)
+			{
+				return generate_trace_v6(prefixes, flows, seed, once);
+			});
+	}
+	std::mt19937 rng(seed);
+	std::vector<double> cdf = generator_zipf_cdf(prefixes.size(), profile.zipf);
+	std::vector<in6_addr_t> rs;
+	rs.reserve(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		in6_addr_t addr;
+		for (auto& b : addr)
+			b = static_cast<uint8_t>(rng());
+		if (prefixes.empty() || generator_uniform(rng) >= profile.hit_ratio)
+		{
+			addr[0] = 0xFD;
+			rs.push_back(addr);
+			continue;
+		}
+		const iptools::cidr_v6& p = prefixes[generator_pick(cdf, rng)];
+		generator_copy_bits(addr, p, p.mask());
+		rs.push_back(addr);
+	}
+	return rs;
+}
+
+} // namespace
@@ -0,0 +1,386 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 01:47:30 */
+
+#pragma once
+#include "lpfst.hpp"
+#include "lpfst_v6.hpp"
+#include "flow_cache.hpp"
+#include <atomic>
+#include <vector>
+#include <memory>
+
+namespace iptools {
+
+/**@brief Key operations needed by the hybrid engine*/
+template<class Key> struct hybrid_key;
+
+template<> struct hybrid_key<uint32_t>
+{
+	using cidr = iptools::cidr_v4;
+	template<class T, class Alloc, class Instr> using trie = basic_lpfst<T, Alloc, Instr>;
+
+	/**@brief full length entry (the trie treats host addresses as /32)*/
+	static bool is_host(const cidr& addr) { return !addr.is_net() || addr.mask() == 32; }
+	static uint32_t key(const cidr& addr) { return addr; }
+	static cidr host(uint32_t key) { return cidr(key, 32); }
+
+	static bool covers(const cidr& net, uint32_t key)
+	{
+		uint32_t mask = net.mask() == 0 ? 0 : ~0U << (32 - net.mask());
+		return (key & mask) == ((uint32_t)net & mask);
+	}
+};
+
+template<> struct hybrid_key<in6_addr_t>
+{
+	using cidr = iptools::cidr_v6;
+	template<class T, class Alloc, class Instr> using trie = basic_lpfst_v6<T, Alloc, Instr>;
+
+	static bool is_host(const cidr& addr) { return !addr.is_net() || addr.mask() == 128; }
+	static in6_addr_t key(const cidr& addr) { return addr; }
+	static cidr host(const in6_addr_t& key) { return cidr(key, 128); }
+
+	static bool covers(const cidr& net, const in6_addr_t& key)
+	{
+		return has_prefix(key, in6_addr_t(net), static_cast<uint8_t>(net.mask()));
+	}
+};
+
+/**@brief Open addressing hash map of the full length entries
+ *
+ * Linear probing, removal shifts the following entries back instead of
+ * leaving tombstones. The table is kept at most 3/4 full.*/
+template<class Key, class T, class Alloc = std::allocator<T> >
+class host_map
+{
+public:
+	host_map() {}
+
+	host_map(const host_map& copy) = default;
+	host_map& operator=(const host_map& copy) = default;
+
+	/**@brief take the entries of other, it is left empty*/
+	host_map(host_map&& other) noexcept
+		: slots_(std::move(other.slots_))
+		, mask_(other.mask_)
+		, size_(other.size_)
+	{
+		other.reset();
+	}
+
+	host_map& operator=(host_map&& other) noexcept
+	{
+		if (this != &other)
+		{
+			slots_ = std::move(other.slots_);
+			mask_  = other.mask_;
+			size_  = other.size_;
+			other.reset();
+		}
+		return *this;
+	}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+	size_t capacity() const { return slots_.size(); }
+
+	const T* find(const Key& key) const
+	{
+		if (size_ == 0)
+			return nullptr;
+		for (size_t i = home(key); slots_[i].used; i = (i + 1) & mask_)
+			if (slots_[i].key == key)
+				return &slots_[i].data;
+		return nullptr;
+	}
+
+	/**@brief insert or replace the data of the key*/
+	void insert(const Key& key, T&& data)
+	{
+		if ((size_ + 1)*4 > slots_.size()*3)
+			rehash(slots_.empty() ? 16 : slots_.size()*2);
+		size_t i = home(key);
+		for (; slots_[i].used; i = (i + 1) & mask_)
+		{
+			if (slots_[i].key == key)
+			{
+				slots_[i].data = std::move(data);
+				return;
+			}
+		}
+		slots_[i].key  = key;
+		slots_[i].data = std::move(data);
+		slots_[i].used = true;
+		++size_;
+	}
+
+	/**@return false if there is no such key*/
+	bool remove(const Key& key)
+	{
+		if (size_ == 0)
+			return false;
+		size_t i = home(key);
+		while (slots_[i].used && slots_[i].key != key)
+			i = (i + 1) & mask_;
+		if (!slots_[i].used)
+			return false;
+		// move back the entries which can't be found past the hole
+		for (size_t j = (i + 1) & mask_; slots_[j].used; j = (j + 1) & mask_)
+		{
+			size_t k = home(slots_[j].key);
+			if (((j - k) & mask_) >= ((j - i) & mask_))
+			{
+				slots_[i].key  = slots_[j].key;
+				slots_[i].data = std::move(slots_[j].data);
+				i = j;
+			}
+		}
+		slots_[i].used = false;
+		slots_[i].data = T();
+		--size_;
+		return true;
+	}
+
+	/**@brief remove all the entries, allocated storage is kept for reuse*/
+	void clear()
+	{
+		for (slot& s : slots_)
+		{
+			if (s.used)
+				s.data = T();
+			s.used = false;
+		}
+		size_ = 0;
+	}
+
+	/**@brief call fun(const Key&, const T&) for every entry*/
+	template<class F> void for_each(F&& fun) const
+	{
+		for (const slot& s : slots_)
+			if (s.used)
+				fun(s.key, s.data);
+	}
+
+	size_t memory_footprint() const { return sizeof(*this) + slots_.capacity()*sizeof(slot); }
+
+private:
+	struct slot
+	{
+		Key  key{};
+		T    data{};
+		bool used{false};
+	};
+	using slot_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<slot>;
+
+	size_t home(const Key& key) const { return flow_key<Key>::hash(key) & mask_; }
+
+	void reset()
+	{
+		slots_.clear();
+		mask_ = 0;
+		size_ = 0;
+	}
+
+	void rehash(size_t capacity)
+	{
+		std::vector<slot, slot_alloc_t> from(capacity);
+		from.swap(slots_);
+		mask_ = capacity - 1;
+		size_ = 0;
+		for (slot& s : from)
+			if (s.used)
+				insert(s.key, std::move(s.data));
+	}
+
+	std::vector<slot, slot_alloc_t> slots_;
+	size_t                          mask_{0};
+	size_t                          size_{0};
+};
+
+/**@brief LPFST with the hash fast path for host routes (/32 and /128)
+ *
+ * Full length entries are kept in the host_map, the rest goes to the trie.
+ * A host entry is always the longest match of its address, so lookup
+ * probes the hash first and goes to the trie only if it misses. Host
+ * heavy tables get a shallower trie and smaller nodes count.
+ *
+ * The trie gets Instr, every lookup is reported to it once: hash hits
+ * as lookups with no visited nodes, the rest with the trie nodes visited
+ * after the hash miss.*/
+template<class Key, class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+class hybrid_lpfst
+{
+	using traits = hybrid_key<Key>;
+
+public:
+	using value_type = T;
+	using cidr       = typename traits::cidr;
+	using trie_type  = typename traits::template trie<T, Alloc, Instr>;
+
+	hybrid_lpfst() {}
+
+	hybrid_lpfst(const hybrid_lpfst& copy) = default;
+	hybrid_lpfst& operator=(const hybrid_lpfst& copy) = default;
+
+	/**@brief take the entries of other, it is left empty*/
+	hybrid_lpfst(hybrid_lpfst&& other) noexcept
+		: hosts_(std::move(other.hosts_))
+		, trie_(std::move(other.trie_))
+		, generation_(other.generation_)
+	{
+		other.clear();
+	}
+
+	hybrid_lpfst& operator=(hybrid_lpfst&& other) noexcept
+	{
+		if (this != &other)
+		{
+			hosts_      = std::move(other.hosts_);
+			trie_       = std::move(other.trie_);
+			generation_ = other.generation_;
+			other.clear();
+		}
+		return *this;
+	}
+
+	/**@brief build from the range of (cidr, T) pairs, the trie is bulk loaded*/
+	template<class It> hybrid_lpfst(It first, It last) { assign(first, last); }
+
+	/**@brief replace the content with the range of (cidr, T) pairs*/
+	template<class It> void assign(It first, It last)
+	{
+		std::vector<std::pair<cidr, T> > nets;
+		hosts_.clear();
+		for (; first != last; ++first)
+		{
+			if (traits::is_host(first->first))
+				hosts_.insert(traits::key(first->first), T((*first).second));
+			else
+				nets.emplace_back(first->first, (*first).second);
+		}
+		trie_.assign(std::make_move_iterator(nets.begin()), std::make_move_iterator(nets.end()));
+		generation_ = next_generation();
+	}
+
+	size_t size() const { return hosts_.size() + trie_.size(); }
+	bool empty() const { return hosts_.empty() && trie_.empty(); }
+
+	/**@brief see basic_lpfst::generation()*/
+	uint64_t generation() const { return generation_; }
+
+	void insert(const cidr& addr, T data)
+	{
+		if (traits::is_host(addr))
+			hosts_.insert(traits::key(addr), std::move(data));
+		else
+			trie_.insert(addr, std::move(data));
+		generation_ = next_generation();
+	}
+
+	template<class... Args> void emplace(const cidr& addr, Args&&... args)
+	{
+		insert(addr, T(std::forward<Args>(args)...));
+	}
+
+	void remove(const cidr& addr)
+	{
+		if (traits::is_host(addr))
+		{
+			if (hosts_.remove(traits::key(addr)))
+				generation_ = next_generation();
+			return;
+		}
+		size_t before = trie_.size();
+		trie_.remove(addr);
+		if (trie_.size() != before)
+			generation_ = next_generation();
+	}
+
+	/**@return data of the longest matching prefix or nullptr*/
+	const T* find(const Key& addr) const
+	{
+		typename Instr::probe probe = trie_.instrumentation().lookup_start();
+		unsigned visited = 0;
+		const T* rs = hosts_.find(addr);
+		if (!rs)
+			rs = trie_.find(addr, visited);
+		trie_.instrumentation().lookup_end(probe, rs != nullptr, visited);
+		return rs;
+	}
+
+	/**@return true if the address belongs any of the inserted CIDRs*/
+	bool check(const Key& addr, T& data) const
+	{
+		const T* rs = find(addr);
+		if (!rs)
+			return false;
+		data = *rs;
+		return true;
+	}
+
+	/**@brief see basic_lpfst::check(cidr_v4, T&)
+	 *
+	 * If the network covers only host entries, they are found by the scan
+	 * of the whole hash, this case takes O(hosts).*/
+	bool check(const cidr& addr, T& data) const
+	{
+		if (traits::is_host(addr))
+			return check(traits::key(addr), data);
+		if (trie_.check(addr, data))
+			return true;
+		bool found = false;
+		hosts_.for_each([&found, &addr](const Key& key, const T&)
+			{
+				found = found || traits::covers(addr, key);
+			});
+		return found;
+	}
+
+	/**@brief call fun(cidr, const T&) for every stored prefix, hosts first*/
+	template<class F> void for_each_prefix(F&& fun) const
+	{
+		hosts_.for_each([&fun](const Key& key, const T& data)
+			{
+				fun(traits::host(key), data);
+			});
+		trie_.for_each_prefix(fun);
+	}
+
+	void clear()
+	{
+		hosts_.clear();
+		trie_.clear();
+		generation_ = 0;
+	}
+
+	const host_map<Key, T, Alloc>& hosts() const { return hosts_; }
+	const trie_type& trie() const { return trie_; }
+
+	const Instr& instrumentation() const { return trie_.instrumentation(); }
+	Instr& instrumentation() { return trie_.instrumentation(); }
+
+	/**@brief approximate number of bytes used by the hash and the trie*/
+	size_t memory_footprint() const
+	{
+		return sizeof(*this) - sizeof(hosts_) + hosts_.memory_footprint()
+			+ trie_.memory_footprint() - sizeof(trie_);
+	}
+
+private:
+	static uint64_t next_generation()
+	{
+		static std::atomic<uint64_t> rs{0};
+		return rs.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	host_map<Key, T, Alloc> hosts_;
+	trie_type               trie_;
+	uint64_t                generation_{0};
+};
+
+template<class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+using basic_hybrid_lpfst = hybrid_lpfst<uint32_t, T, Alloc, Instr>;
+template<class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+using basic_hybrid_lpfst_v6 = hybrid_lpfst<in6_addr_t, T, Alloc, Instr>;
+
+} // namespace
@@ -0,0 +1,322 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 23:41:09 */
+
+#pragma once
+#include "compiler.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace iptools {
+
+/**@brief Lookup instrumentation policy doing nothing (the default)
+ *
+ * Engines call lookup_start() before every lookup and lookup_end() after
+ * it with the result and the number of visited nodes. Hooks are empty
+ * inline functions and the policy is an empty base, so the uninstrumented
+ * engine has the same code and size as before.
+ *
+ * Another policy should provide the same const hooks and a non-throwing
+ * move, engines move it in their noexcept move operations. A value initialized
+ * probe is passed to lookup_end() for lookups which were not started
+ * individually (check_batch) and should not be timed.*/
+struct no_instrumentation
+{
+	struct probe {};
+
+	probe lookup_start() const { return probe(); }
+	void lookup_end(probe, bool, unsigned) const {}
+};
+
+/**@brief Log-linear latency histogram (HDR-style)
+ *
+ * Values below 16 get their own buckets, every next power of two range is
+ * split into 16 buckets, so the relative error is below 1/16 over the
+ * whole uint64_t range. Buckets are relaxed atomics, record() is safe to
+ * call from many threads.*/
+class latency_histogram
+{
+public:
+	static const unsigned sub_bits     = 4;
+	static const unsigned sub_count    = 1U << sub_bits;
+	static const unsigned bucket_count = (64 - sub_bits + 1)*sub_count;
+
+	latency_histogram() { reset(); }
+
+	latency_histogram(const latency_histogram&) = delete;
+	latency_histogram& operator=(const latency_histogram&) = delete;
+
+	void record(uint64_t v)
+	{
+		counts_[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+		sum_.fetch_add(v, std::memory_order_relaxed);
+	}
+
+	uint64_t count() const
+	{
+		uint64_t rs = 0;
+		for (unsigned i = 0; i < bucket_count; ++i)
+			rs += counts_[i].load(std::memory_order_relaxed);
+		return rs;
+	}
+
+	uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+	/**@return the highest value of the bucket holding q-th quantile
+	 * (0 <= q <= 1), 0 if nothing is recorded*/
+	uint64_t percentile(double q) const
+	{
+		uint64_t counts[bucket_count];
+		uint64_t total = 0;
+		for (unsigned i = 0; i < bucket_count; ++i)
+			total += counts[i] = counts_[i].load(std::memory_order_relaxed);
+		if (total == 0)
+			return 0;
+		uint64_t rank = static_cast<uint64_t>(q*total + 0.5);
+		if (rank < 1)
+			rank = 1;
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < bucket_count; ++i)
+			if ((seen += counts[i]) >= rank)
+				return highest(i);
+		return highest(bucket_count - 1);
+	}
+
+	void reset()
+	{
+		for (unsigned i = 0; i < bucket_count; ++i)
+			counts_[i].store(0, std::memory_order_relaxed);
+		sum_.store(0, std::memory_order_relaxed);
+	}
+
+	/**@brief add the values recorded by other*/
+	void add(const latency_histogram& other)
+	{
+		for (unsigned i = 0; i < bucket_count; ++i)
+			counts_[i].fetch_add(other.counts_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+	}
+
+	static unsigned bucket(uint64_t v)
+	{
+		if (v < sub_count)
+			return static_cast<unsigned>(v);
+		unsigned e = 63 - clz64(v);
+		return (e - sub_bits + 1)*sub_count + static_cast<unsigned>((v >> (e - sub_bits)) & (sub_count - 1));
+	}
+
+	/**@brief the lowest value of the bucket*/
+	static uint64_t lowest(unsigned i)
+	{
+		if (i < sub_count)
+			return i;
+		unsigned e = i/sub_count + sub_bits - 1;
+		return (uint64_t)(sub_count + i%sub_count) << (e - sub_bits);
+	}
+
+	/**@brief the highest value of the bucket*/
+	static uint64_t highest(unsigned i)
+	{
+		if (i < sub_count)
+			return i;
+		unsigned e = i/sub_count + sub_bits - 1;
+		return lowest(i) + ((uint64_t)1 << (e - sub_bits)) - 1;
+	}
+
+private:
+	std::atomic<uint64_t> counts_[bucket_count];
+	std::atomic<uint64_t> sum_;
+};
+
+/**@brief Lookup instrumentation policy counting hits, misses and visited
+ * nodes, every sample_every()-th lookup of the thread is timed into the
+ * latency histogram (nanoseconds).
+ *
+ * Counters and the sampling countdown are sharded by thread, every shard
+ * takes its own cache line, so lookup threads don't bounce the lines and
+ * the tables don't shift each other's sampling. Threads over shard_count
+ * share the shards: counts stay exact, sampling becomes approximate.
+ * Readers sum the shards. A copy of the engine starts with zero counters,
+ * a moved engine takes the counters without allocating. The moved-from
+ * one reads zero and counts into the shared sink until it is assigned.*/
+class lookup_metrics
+{
+public:
+	using probe = uint64_t; //!< start time, 0 - not timed
+
+	static const size_t shard_count = 16;
+
+	lookup_metrics() { init(); }
+	lookup_metrics(const lookup_metrics& copy) : sample_every_(copy.sample_every_) { init(); }
+	lookup_metrics& operator=(const lookup_metrics& copy)
+	{
+		sample_every_ = copy.sample_every_;
+		if (shards_ == sink())
+			init();
+		return *this;
+	}
+
+	lookup_metrics(lookup_metrics&& other) noexcept
+		: sample_every_(other.sample_every_)
+		, storage_(std::move(other.storage_))
+		, shards_(other.shards_)
+	{
+		latency_.add(other.latency_);
+		other.latency_.reset();
+		other.shards_ = sink();
+	}
+
+	/**@brief take the counters of other, it gets the zero ones*/
+	lookup_metrics& operator=(lookup_metrics&& other) noexcept
+	{
+		if (this != &other)
+		{
+			sample_every_ = other.sample_every_;
+			storage_.swap(other.storage_);
+			std::swap(shards_, other.shards_);
+			latency_.reset();
+			latency_.add(other.latency_);
+			other.reset();
+		}
+		return *this;
+	}
+
+	~lookup_metrics()
+	{
+		if (storage_)
+			for (size_t i = 0; i < shard_count; ++i)
+				shards_[i].~shard();
+	}
+
+	probe lookup_start() const
+	{
+		shard&   s         = local();
+		uint32_t countdown = s.countdown.load(std::memory_order_relaxed);
+		if (countdown != 0)
+		{
+			s.countdown.store(countdown - 1, std::memory_order_relaxed);
+			return 0;
+		}
+		s.countdown.store(sample_every_ - 1, std::memory_order_relaxed);
+		return now();
+	}
+
+	void lookup_end(probe start, bool hit, unsigned visited) const
+	{
+		if (start != 0)
+			latency_.record(now() - start);
+		shard& s = local();
+		(hit ? s.hits : s.misses).fetch_add(1, std::memory_order_relaxed);
+		s.visited.fetch_add(visited, std::memory_order_relaxed);
+	}
+
+	uint64_t hits() const { return total(&shard::hits); }
+	uint64_t misses() const { return total(&shard::misses); }
+	uint64_t visited() const { return total(&shard::visited); }
+	const latency_histogram& latency() const { return latency_; }
+
+	uint32_t sample_every() const { return sample_every_; }
+	/**@brief time every n-th lookup of the thread, 1 - every lookup*/
+	void set_sample_every(uint32_t n) { sample_every_ = n == 0 ? 1 : n; }
+
+	void reset()
+	{
+		for (size_t i = 0; shards_ != sink() && i < shard_count; ++i)
+		{
+			shards_[i].hits.store(0, std::memory_order_relaxed);
+			shards_[i].misses.store(0, std::memory_order_relaxed);
+			shards_[i].visited.store(0, std::memory_order_relaxed);
+		}
+		latency_.reset();
+	}
+
+	/**@brief counters in the Prometheus text exposition format
+	 *
+	 * Counters are read one by one without stopping the lookups, so the
+	 * snapshot is consistent only approximately.
+	 * @param name metric name prefix*/
+	std::string str(const std::string& name = "lpfst") const
+	{
+		std::stringstream ss;
+		ss << "# TYPE " << name << "_lookups_total counter\n"
+		   << name << "_lookups_total{result=\"hit\"} " << hits() << "\n"
+		   << name << "_lookups_total{result=\"miss\"} " << misses() << "\n"
+		   << "# TYPE " << name << "_nodes_visited_total counter\n"
+		   << name << "_nodes_visited_total " << visited() << "\n"
+		   << "# TYPE " << name << "_lookup_latency_ns summary\n";
+		const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+		for (double q : quantiles)
+		{
+			ss << name << "_lookup_latency_ns{quantile=\"" << q << "\"} "
+			   << latency_.percentile(q) << "\n";
+		}
+		ss << name << "_lookup_latency_ns_sum " << latency_.sum() << "\n"
+		   << name << "_lookup_latency_ns_count " << latency_.count() << "\n";
+		return ss.str();
+	}
+
+private:
+	static const size_t line = 64;
+
+	struct alignas(line) shard
+	{
+		std::atomic<uint64_t> hits{0};
+		std::atomic<uint64_t> misses{0};
+		std::atomic<uint64_t> visited{0};
+		std::atomic<uint32_t> countdown{0}; //!< lookups until the next timed one
+	};
+
+	static uint64_t now()
+	{
+		uint64_t rs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+		return rs == 0 ? 1 : rs;
+	}
+
+	/**@brief number of the calling thread, the same for all the instances*/
+	static size_t thread_number()
+	{
+		static std::atomic<size_t> next{0};
+		static thread_local size_t rs = next.fetch_add(1, std::memory_order_relaxed);
+		return rs;
+	}
+
+	shard& local() const { return shards_[thread_number() % shard_count]; }
+
+	/**@brief shards of the moved-from instances, never read*/
+	static shard* sink()
+	{
+		static shard rs[shard_count];
+		return rs;
+	}
+
+	uint64_t total(std::atomic<uint64_t> shard::* counter) const
+	{
+		uint64_t rs = 0;
+		for (size_t i = 0; shards_ != sink() && i < shard_count; ++i)
+			rs += (shards_[i].*counter).load(std::memory_order_relaxed);
+		return rs;
+	}
+
+	void init()
+	{
+		// new doesn't honour the shard alignment before C++17
+		storage_.reset(new unsigned char[shard_count*sizeof(shard) + line - 1]);
+		shards_ = reinterpret_cast<shard*>(
+			(reinterpret_cast<uintptr_t>(storage_.get()) + line - 1) & ~(uintptr_t)(line - 1));
+		for (size_t i = 0; i < shard_count; ++i)
+			new (shards_ + i) shard();
+	}
+
+	uint32_t                         sample_every_{64};
+	std::unique_ptr<unsigned char[]> storage_;
+	shard*                           shards_{nullptr}; //!< line aligned in storage_
+	mutable latency_histogram        latency_;
+};
+
+} // namespace
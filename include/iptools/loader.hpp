@@ -0,0 +1,222 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 19:12:09 */
+
+#pragma once
+#include "lpfst.hpp"
+#include "lpfst_v6.hpp"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <type_traits>
+#include <unistd.h>
+
+namespace iptools {
+
+/**@brief call fun(const char* first, const char* last) for every line of
+ * the memory block (mapped file), the line is passed without '\n'*/
+template<class F> void
+for_each_line(const char* data, size_t len, F&& fun)
+{
+	const char* end = data + len;
+	const char* nl;
+	while ((nl = static_cast<const char*>(memchr(data, '\n', end - data))) != nullptr)
+	{
+		fun(data, nl);
+		data = nl + 1;
+	}
+	if (data != end)
+		fun(data, end);
+}
+
+/**@brief read fd to the end by chunks and call fun(const char* first,
+ * const char* last) for every line, the line is passed without '\n'
+ * @return false on read error*/
+template<class F> bool
+for_each_line(int fd, F&& fun, size_t chunk = 1 << 20)
+{
+	std::vector<char> buf(chunk > 0 ? chunk : 1);
+	size_t used = 0;
+	for (;;)
+	{
+		if (used == buf.size()) // the line is longer than the buffer
+			buf.resize(buf.size()*2);
+		ssize_t rs = ::read(fd, buf.data() + used, buf.size() - used);
+		if (rs < 0 && errno == EINTR)
+			continue;
+		if (rs < 0)
+			return false;
+		if (rs == 0)
+			break;
+		const char* first = buf.data();
+		const char* end   = buf.data() + used + rs;
+		const char* nl;
+		while ((nl = static_cast<const char*>(memchr(first, '\n', end - first))) != nullptr)
+		{
+			fun(first, nl);
+			first = nl + 1;
+		}
+		used = end - first;
+		memmove(buf.data(), first, used);
+	}
+	if (used > 0)
+		fun(buf.data(), buf.data() + used);
+	return true;
+}
+
+/**@brief parse the whole range as the cidr (see cidr_v4::parse, cidr_v6::parse)*/
+inline bool
+parse_cidr(const char* first, const char* last, iptools::cidr_v4& out)
+{
+	return iptools::cidr_v4::parse(first, last - first, out) == parse_error::ok;
+}
+
+inline bool
+parse_cidr(const char* first, const char* last, iptools::cidr_v6& out)
+{
+	return iptools::cidr_v6::parse(first, last - first, out) == parse_error::ok;
+}
+
+/**@brief value column parser, the column is ignored by default*/
+template<class T, class Enable = void> struct value_parser
+{
+	bool operator()(const char*, const char*, T& out) const
+	{
+		out = T();
+		return true;
+	}
+};
+
+/**@brief unsigned decimal*/
+template<class T> struct value_parser<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+	bool operator()(const char* first, const char* last, T& out) const
+	{
+		uint64_t rs = 0;
+		if (first == last || last - first > 19)
+			return false;
+		for (; first != last; ++first)
+		{
+			if (*first < '0' || *first > '9')
+				return false;
+			rs = rs*10 + (*first - '0');
+		}
+		out = static_cast<T>(rs);
+		return static_cast<uint64_t>(out) == rs;
+	}
+};
+
+template<> struct value_parser<std::string>
+{
+	bool operator()(const char* first, const char* last, std::string& out) const
+	{
+		out.assign(first, last);
+		return true;
+	}
+};
+
+/**@brief counters of the list loading*/
+struct load_stats
+{
+	size_t lines{0};   //!< all the lines including empty and comments
+	size_t loaded{0};  //!< prefixes passed to the table
+	size_t invalid{0}; //!< lines with the wrong prefix or value
+};
+
+/**@brief Parser of the prefix list lines
+ *
+ * Line is "<cidr>[<separator><value>]", separator is any number of spaces,
+ * tabs or commas. Empty lines and lines starting with '#' are skipped,
+ * trailing whitespace ('\r' too) is ignored. Lines without value get T().
+ * Parsed pairs are appended to the vector.*/
+template<class Cidr, class T, class V = value_parser<T> >
+class cidr_list_parser
+{
+public:
+	cidr_list_parser(std::vector<std::pair<Cidr, T> >& out, load_stats& stats, V parse_value = V())
+		: out_(out)
+		, stats_(stats)
+		, parse_value_(parse_value)
+	{}
+
+	void operator()(const char* first, const char* last)
+	{
+		++stats_.lines;
+		while (first != last && is_space(*first))
+			++first;
+		while (first != last && is_space(*(last - 1)))
+			--last;
+		if (first == last || *first == '#')
+			return;
+		const char* sep = first;
+		while (sep != last && !is_space(*sep) && *sep != ',')
+			++sep;
+		const char* value = sep;
+		while (value != last && (is_space(*value) || *value == ','))
+			++value;
+		Cidr addr;
+		T    data = T();
+		if (!parse_cidr(first, sep, addr) || (value != last && !parse_value_(value, last, data)))
+		{
+			++stats_.invalid;
+			return;
+		}
+		out_.emplace_back(addr, data);
+		++stats_.loaded;
+	}
+
+private:
+	static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	std::vector<std::pair<Cidr, T> >& out_;
+	load_stats&                       stats_;
+	V                                 parse_value_;
+};
+
+/**@brief read the prefix list from fd and bulk load the table
+ *
+ * The table content is replaced (assign()).
+ * @param stats if not null, filled with the loading counters
+ * @return false on read error, the table is not changed in this case*/
+template<class T, class Alloc, class Instr, class V = value_parser<T> > bool
+load(int fd, basic_lpfst<T, Alloc, Instr>& to, load_stats* stats = nullptr, V parse_value = V())
+{
+	load_stats tmp;
+	std::vector<std::pair<iptools::cidr_v4, T> > list;
+	if (!for_each_line(fd, cidr_list_parser<iptools::cidr_v4, T, V>(list, stats ? *stats : tmp, parse_value)))
+		return false;
+	to.assign(list.begin(), list.end());
+	return true;
+}
+
+template<class T, class Alloc, class Instr, class V = value_parser<T> > bool
+load(int fd, basic_lpfst_v6<T, Alloc, Instr>& to, load_stats* stats = nullptr, V parse_value = V())
+{
+	load_stats tmp;
+	std::vector<std::pair<iptools::cidr_v6, T> > list;
+	if (!for_each_line(fd, cidr_list_parser<iptools::cidr_v6, T, V>(list, stats ? *stats : tmp, parse_value)))
+		return false;
+	to.assign(list.begin(), list.end());
+	return true;
+}
+
+/**@brief bulk load the table from the prefix list in memory (mapped file)*/
+template<class T, class Alloc, class Instr, class V = value_parser<T> > void
+load(const char* data, size_t len, basic_lpfst<T, Alloc, Instr>& to, load_stats* stats = nullptr, V parse_value = V())
+{
+	load_stats tmp;
+	std::vector<std::pair<iptools::cidr_v4, T> > list;
+	for_each_line(data, len, cidr_list_parser<iptools::cidr_v4, T, V>(list, stats ? *stats : tmp, parse_value));
+	to.assign(list.begin(), list.end());
+}
+
+template<class T, class Alloc, class Instr, class V = value_parser<T> > void
+load(const char* data, size_t len, basic_lpfst_v6<T, Alloc, Instr>& to, load_stats* stats = nullptr, V parse_value = V())
+{
+	load_stats tmp;
+	std::vector<std::pair<iptools::cidr_v6, T> > list;
+	for_each_line(data, len, cidr_list_parser<iptools::cidr_v6, T, V>(list, stats ? *stats : tmp, parse_value));
+	to.assign(list.begin(), list.end());
+}
+
+} // namespace
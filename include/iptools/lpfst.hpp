@@ -3,97 +3,270 @@
 
 #pragma once
 #include "cidr.hpp"
+#include "compiler.hpp"
+#include "radix_sort.hpp"
+#include "lpfst_stats.hpp"
+#include "lpfst_payload.hpp"
+#include "instrumentation.hpp"
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <sstream>
-#include <functional>
+#include <memory>
+#include <atomic>
 
 namespace iptools {
 
+/**@brief Node of the frozen LPFST (basic_lpfst::snapshot, lpfst image)*/
+struct lpfst_frozen_node
+{
+	static const uint32_t nil = 0xFFFFFFFF;
+
+	uint32_t prefix;
+	uint32_t mask;
+	uint32_t child[2]; //!< 0 means no child (root is never a child)
+};
+
+/**@return index of the node matching the address (host byte order) or nil*/
+inline uint32_t
+lpfst_frozen_find(const lpfst_frozen_node* nodes, size_t count, const uint32_t addr)
+{
+	if (count == 0)
+		return lpfst_frozen_node::nil;
+	uint32_t i = 0;
+	for (uint8_t level = 0; ; ++level)
+	{
+		const lpfst_frozen_node& y = nodes[i];
+		if ((addr & y.mask) == y.prefix)
+			return i;
+		i = y.child[((uint64_t)addr << level >> 31) & 1];
+		if (i == 0)
+			return lpfst_frozen_node::nil;
+	}
+}
+
+/**@return true if the address belongs any of the frozen CIDRs, idx is
+ * the matching node or nil if the network covers a subtree*/
+inline bool
+lpfst_frozen_find(const lpfst_frozen_node* nodes, size_t count,
+                  const iptools::cidr_v4& addr, uint32_t& idx)
+{
+	idx = lpfst_frozen_node::nil;
+	if (count == 0)
+		return false;
+	bool     is_net  = addr.is_net();
+	uint32_t addr_i  = (uint32_t)addr;
+	uint8_t  mask    = addr.mask();
+	uint32_t netmask = mask == 0 ? 0 : ~0U << (32 - mask);
+	uint32_t i       = 0;
+	for (uint8_t level = 0; ; ++level)
+	{
+		if (is_net && mask < level)
+			return true;
+		const lpfst_frozen_node& y = nodes[i];
+		if (!is_net || (netmask & y.mask) == y.mask)
+		{
+			if ((addr_i & y.mask) == y.prefix)
+			{
+				idx = i;
+				return true;
+			}
+		}
+		i = y.child[((uint64_t)addr_i << level >> 31) & 1];
+		if (i == 0)
+			return false;
+	}
+}
+
 /**@brief Data structure allows to add some CIDR networks and check if
  * the given address belongs to any of them.
  *
- * Based on Longest Prefix First Search Tree (LPFST)*/
-template<class T>
-class basic_lpfst
+ * Based on Longest Prefix First Search Tree (LPFST). Nodes are kept in one
+ * arena (vector allocated with Alloc) and linked by 32-bit indices, so
+ * building the tree does not allocate per node, clear() and destruction
+ * release the storage at once and copying is a block copy.
+ *
+ * T larger than 4 bytes is kept in the parallel array (see lpfst_payload),
+ * the node takes 16 bytes (four per cache line) and the descent doesn't
+ * touch the data. T up to 4 bytes stays in the node: a 4-byte T (the
+ * common uint32_t) makes it 20 bytes, 1 or 2 bytes still fit into 16. The
+ * 4-byte case is left inline on purpose, the extra load of the parallel
+ * array at the match cost more than the smaller node saved.
+ *
+ * Instr is the lookup instrumentation policy (see no_instrumentation,
+ * lookup_metrics) notified about every find() and check().*/
+template<class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+class basic_lpfst : private Instr, private lpfst_payload<T, Alloc>
 {
 public:
+	using value_type = T;
+
+	basic_lpfst() {}
 
-	basic_lpfst() : root_{nullptr}, size_(0) {}
+	virtual ~basic_lpfst() {}
 
-	virtual ~basic_lpfst() { clear(); }
+	basic_lpfst(const basic_lpfst& copy) = default;
+	basic_lpfst& operator=(const basic_lpfst& copy) = default;
 
-	basic_lpfst(const basic_lpfst& copy)
+	/**@brief take the nodes of other, it is left empty*/
+	basic_lpfst(basic_lpfst&& other) noexcept
+		: Instr(std::move(static_cast<Instr&>(other)))
+		, lpfst_payload<T, Alloc>(std::move(other))
+		, nodes_(std::move(other.nodes_))
+		, root_(other.root_)
+		, free_(other.free_)
+		, size_(other.size_)
+		, generation_(other.generation_)
 	{
-		operator=(copy);
+		other.clear();
 	}
 
-	basic_lpfst& operator=(const basic_lpfst& copy)
+	basic_lpfst& operator=(basic_lpfst&& other) noexcept
 	{
-		clear();
-		if (!copy.root_)
-			return *this;
-		root_.reset(new node(copy.root_->len, copy.root_->prefix, copy.root_->data));
-		recurse_copy(copy.root_, root_);
-		size_ = copy.size_;
+		if (this != &other)
+		{
+			Instr::operator=(std::move(static_cast<Instr&>(other)));
+			nodes_ = std::move(other.nodes_);
+			lpfst_payload<T, Alloc>::operator=(std::move(other));
+			root_  = other.root_;
+			free_  = other.free_;
+			size_  = other.size_;
+			generation_ = other.generation_;
+			other.clear();
+		}
 		return *this;
 	}
 
+	/**@brief build the tree from the range of (cidr_v4, T) pairs, see assign()*/
+	template<class It> basic_lpfst(It first, It last) { assign(first, last); }
+
+	/**@brief replace the content with the range of (cidr_v4, T) pairs
+	 *
+	 * The pairs are radix sorted and the tree is built top-down over the
+	 * sorted array with one sequential pass per level, so the build takes
+	 * O(32n) without swapping the data along the insertion paths. The last
+	 * data is kept for duplicates. A prefix is dropped (as insert() does)
+	 * if the longer one takes the node at the level equal to its length.*/
+	template<class It> void assign(It first, It last);
+
 	size_t size() const { return size_; }
 
+	/**@brief changed by every modification, trees with the same generation
+	 * have the same content (one is a copy of the other)*/
+	uint64_t generation() const { return generation_; }
+
+	/**@brief data is moved along the insertion path, T may be move-only*/
 	void insert(iptools::cidr_v4 addr, T data)
 	{
-		if (!root_)
+		generation_ = next_generation();
+		if (root_ == nil)
 		{
-			root_.reset(new node(addr, data));
+			root_ = new_node(addr, std::move(data));
 			size_ = 1;
 			return;
 		}
-		insert(addr, data, root_, 0);
+		insert(addr, std::move(data), root_);
 	}
 
-	void remove(const iptools::cidr_v4& addr)
+	/**@brief insert T constructed from args*/
+	template<class... Args> void emplace(iptools::cidr_v4 addr, Args&&... args)
 	{
-		remove(addr, root_, 0);
-		--size_;
+		insert(addr, T(std::forward<Args>(args)...));
 	}
 
-	/**@return true if the address belongs any of the inserted CIDRs*/
-	bool check(const iptools::cidr_v4& addr, T& data) const
+	void remove(const iptools::cidr_v4& toremove)
 	{
-		node*	y	  = root_.get();
-		uint8_t  level  = 0;
-		bool	 is_net = addr.is_net();
-		uint32_t addr_i = (uint32_t)addr;
-		uint8_t  mask   = addr.mask();
-		while (y != nullptr)
+		index_t* link = &root_;
+		for (uint8_t level = 0; *link != nil; ++level)
 		{
-			if (is_net && mask < level)
-				return true;
-			if (!is_net || (is_net && mask >= y->len))
+			node& y = nodes_[*link];
+			if (toremove == y.prefix)
+				break;
+			if (len(toremove) == level)
+				return;
+			if ((((uint32_t)toremove >> (31 - level)) & 1) == 0)
+				link = &y.left;
+			else
+				link = &y.right;
+		}
+		if (*link == nil)
+			return;
+		--size_;
+		generation_ = next_generation();
+		// push the node down to the leaf swapping with the longest child
+		for (;;)
+		{
+			index_t cur = *link;
+			node&   y   = nodes_[cur];
+			if (y.right == nil && y.left == nil)
 			{
-				uint32_t cmp_mask = ~0;
-				cmp_mask <<= 32 - y->len;
-				if ((addr_i & cmp_mask) == y->prefix)
-				{
-					data = y->data;
-					return true;
-				}
+				free_node(*link);
+				*link = nil;
+				return;
+			}
+			if (y.right == nil || (y.left != nil && (nodes_[y.left].len > nodes_[y.right].len)))
+			{
+				y.swap(nodes_[y.left]);
+				std::swap(this->data_at(nodes_.data(), cur), this->data_at(nodes_.data(), y.left));
+				link = &y.left;
 			}
-			if ((addr_i & (1 << (31 - level))) == 0)
-				y = y->left.get();
 			else
-				y = y->right.get();
-			++level;
+			{
+				y.swap(nodes_[y.right]);
+				std::swap(this->data_at(nodes_.data(), cur), this->data_at(nodes_.data(), y.right));
+				link = &y.right;
+			}
 		}
-		return false;
+	}
+
+	/**@return true if the address belongs any of the inserted CIDRs*/
+	bool check(const iptools::cidr_v4& addr, T& data) const
+	{
+		bool found = false;
+		const node* y = match(addr, found);
+		if (y)
+			data = value(*y);
+		return found;
 	}
 
 	/**@return true if the address belongs any of the inserted CIDRs
 	 * @param addr in host byte order*/
 	bool check(const uint32_t addr, T& data) const
 	{
-		node*  y = root_.get();
+		const T* rs = find(addr);
+		if (!rs)
+			return false;
+		data = *rs;
+		return true;
+	}
+
+	/**@brief check() without copying the data
+	 * @return data of the longest matching prefix or nullptr, also nullptr
+	 * if the network only covers some of the inserted CIDRs (check()
+	 * returns true without data in this case). The pointer is valid until
+	 * the tree is modified.*/
+	const T* find(const iptools::cidr_v4& addr) const
+	{
+		bool found = false;
+		const node* y = match(addr, found);
+		return y ? &value(*y) : nullptr;
+	}
+
+	/**@param addr in host byte order*/
+	const T* find(const uint32_t addr) const
+	{
+		typename Instr::probe probe = instrumentation().lookup_start();
+		unsigned visited;
+		const T* rs = find(addr, visited);
+		instrumentation().lookup_end(probe, rs != nullptr, visited);
+		return rs;
+	}
+
+	/**@brief find() not reported to the instrumentation
+	 * @param visited set to the number of visited nodes*/
+	const T* find(const uint32_t addr, unsigned& visited) const
+	{
+		const node* y = at(root_);
 		uint8_t  level = 0;
 		uint32_t addr_ = addr;
 		while (y != nullptr)
@@ -102,74 +275,170 @@ public:
 			cmp_mask <<= 32 - y->len;
 			if ((addr_ & cmp_mask) == y->prefix)
 			{
-				data = y->data;
-				return true;
+				visited = level + 1U;
+				return &value(*y);
 			}
 			if ((addr_ & (1 << (31 - level))) == 0)
-				y = y->left.get();
+				y = at(y->left);
 			else
-				y = y->right.get();
+				y = at(y->right);
 			++level;
 		}
-		return false;
+		visited = level;
+		return nullptr;
+	}
+
+	/**@brief check n addresses (host byte order) at once
+	 *
+	 * Lookups are advanced in groups one level at a time and the next node
+	 * of every lookup is prefetched before it is touched, so the cache
+	 * misses of the group overlap.
+	 * @param found found[i] is set to 1 if addrs[i] belongs any of the
+	 * inserted CIDRs (out[i] is assigned only in this case), 0 otherwise*/
+	void check_batch(const uint32_t* addrs, size_t n, T* out, uint8_t* found) const
+	{
+		const size_t group = 16;
+		const node*  cur[group];
+		unsigned     visited[group];
+		for (size_t base = 0; base < n; base += group)
+		{
+			size_t cnt = n - base < group ? n - base : group;
+			size_t active = 0;
+			for (size_t i = 0; i < cnt; ++i)
+			{
+				cur[i] = at(root_);
+				found[base + i] = 0;
+				visited[i] = 0;
+				if (cur[i])
+					++active;
+			}
+			for (uint8_t level = 0; active > 0; ++level)
+			{
+				for (size_t i = 0; i < cnt; ++i)
+				{
+					const node* y = cur[i];
+					if (!y)
+						continue;
+					++visited[i];
+					uint32_t addr_ = addrs[base + i];
+					uint32_t cmp_mask = ~0;
+					cmp_mask <<= 32 - y->len;
+					if ((addr_ & cmp_mask) == y->prefix)
+					{
+						out[base + i] = value(*y);
+						found[base + i] = 1;
+						y = nullptr;
+					}
+					else if ((addr_ & (1 << (31 - level))) == 0)
+					{
+						y = at(y->left);
+					}
+					else
+					{
+						y = at(y->right);
+					}
+					if (y)
+						prefetch(y);
+					else
+						--active;
+					cur[i] = y;
+				}
+			}
+			for (size_t i = 0; i < cnt; ++i)
+				instrumentation().lookup_end(typename Instr::probe(), found[base + i] != 0, visited[i]);
+		}
 	}
 
 	bool empty() const
 	{
-		return !(bool)root_;
+		return root_ == nil;
 	}
 
-	void clear()
+	/**@brief the lookup instrumentation policy with its counters*/
+	const Instr& instrumentation() const { return *this; }
+	Instr& instrumentation() { return *this; }
+
+	/**@brief call fun(cidr_v4, const T&) for every stored prefix*/
+	template<class F> void for_each_prefix(F&& fun) const
 	{
-		walk(root_, 0, nullptr,
-			[](node_ptr_t& cur, uint8_t level)
+		walk([this, &fun](const node& y, uint8_t, bool)
 			{
-				cur->left.reset(nullptr);
-				cur->right.reset(nullptr);
+				fun(iptools::cidr_v4(y.prefix, y.len), value(y));
 			});
-		root_.reset(nullptr);
+	}
+
+	class snapshot;
+
+	/**@brief compile the tree into the contiguous read-only snapshot*/
+	snapshot freeze() const;
+
+	/**@brief walk the tree and collect its structure and memory usage*/
+	lpfst_stats stats() const;
+
+	/**@brief bytes allocated by the tree (stats().bytes without the walk),
+	 * heap owned by T is not counted*/
+	size_t memory_footprint() const
+	{
+		return sizeof(*this) + nodes_.capacity()*sizeof(node) + this->data_bytes();
+	}
+
+	/**@brief remove all the prefixes, allocated storage is kept for reuse*/
+	void clear()
+	{
+		nodes_.clear();
+		this->data_clear();
+		root_ = nil;
+		free_ = nil;
 		size_ = 0;
+		// all the empty trees are equal
+		generation_ = 0;
 	}
 
-	std::string print()
+	std::string print() const
 	{
-		if (!root_)
-			return {};
 		std::stringstream ss;
-		ss << inet_ntoa(*(struct in_addr*)&root_->prefix) << " " << root_->data;
-		walk(root_, 0, [&ss](node_ptr_t& cur, uint8_t level, bool left)
+		char tmp[iptools::cidr_v4::max_str_len];
+		walk([this, &ss, &tmp](const node& cur, uint8_t level, bool left)
 				{
+					char* end = iptools::cidr_v4(cur.prefix, cur.len).to_chars(tmp, tmp + sizeof(tmp));
+					if (level == 0)
+					{
+						ss.write(tmp, end - tmp) << " " << value(cur);
+						return;
+					}
 					ss << std::endl << (int)level;
 					for (uint8_t i = 0; i < level; ++i)
 						ss << "  ";
-					ss << (left ? "[-] " : "[+] ") << inet_ntoa(*(struct in_addr*)&cur->prefix) << " " << cur->data;
-				}, nullptr);
+					ss << (left ? "[-] " : "[+] ");
+					ss.write(tmp, end - tmp) << " " << value(cur);
+				});
 		return ss.str();
 	}
 
 protected:
 
 	struct node;
-	using node_ptr_t = std::unique_ptr<node>;
+	using index_t = uint32_t;
+	using node_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+
+	static const index_t nil = 0xFFFFFFFF;
 
 	inline uint8_t len(const iptools::cidr_v4 addr) { return addr.is_net() ? addr.mask() : 32; }
 
-	struct node
+	struct node : lpfst_payload<T, Alloc>::slot
 	{
-		node(uint8_t len, uint32_t prefix, T data)
+		node(uint8_t len, uint32_t prefix)
 			: len(len > 32 ? 32 : len)
 			, prefix(prefix)
-			, data(data)
-			, left(nullptr)
-			, right(nullptr)
+			, left(nil)
+			, right(nil)
 		{}
 
-		node(const iptools::cidr_v4& addr, T data)
+		explicit node(const iptools::cidr_v4& addr)
 			: len(addr.is_net() ? addr.mask() : (uint8_t)32)
 			, prefix(addr)
-			, data(data)
-			, left(nullptr)
-			, right(nullptr)
+			, left(nil)
+			, right(nil)
 		{}
 
 		template <typename I> void swap(I& x, I& y)
@@ -179,21 +448,14 @@ protected:
 			x = x ^ y;
 		}
 
-		void swap(node_ptr_t& rhv)
+		void swap(node& rhv)
 		{
-			swap(len, rhv->len);
-			swap(prefix, rhv->prefix);
-			T tmp = data;
-			data = rhv->data;
-			rhv->data = tmp;
+			swap(len, rhv.len);
+			swap(prefix, rhv.prefix);
 		}
 
-		void swap(iptools::cidr_v4& addr, T& data)
+		void swap(iptools::cidr_v4& addr)
 		{
-			T aux = this->data;
-			this->data = data;
-			data = aux;
-
 			iptools::cidr_v4 aux_addr(prefix, len);
 			len = addr.is_net() ? addr.mask() : 32;
 			prefix = addr;
@@ -202,117 +464,348 @@ protected:
 
 		uint8_t     len;
 		uint32_t    prefix;
-		T           data;
-		node_ptr_t  left;
-		node_ptr_t  right;
+		index_t     left;
+		index_t     right;
 	};
 
-	void insert(iptools::cidr_v4 addr, T data, node_ptr_t& cur, uint8_t level)
+	const node* at(index_t i) const { return i == nil ? nullptr : &nodes_[i]; }
+
+	/**@brief data of the node*/
+	const T& value(const node& y) const { return this->data_at(nodes_.data(), &y - nodes_.data()); }
+
+	/**@brief the node matching the network, found is set to true also if
+	 * the network covers a subtree (nullptr is returned then)*/
+	const node* match(const iptools::cidr_v4& addr, bool& found) const
 	{
-		if (len(addr) >= cur->len)
-			cur->swap(addr, data);
-		if (len(addr) == cur->len && ((uint32_t)addr>>(32-cur->len) == cur->prefix>>(32-cur->len)))
-			return;
-		if (len(addr) == level)
-			return;
-		if ((((uint32_t)addr >> (31 - level)) & 1) == 0)
+		typename Instr::probe probe = instrumentation().lookup_start();
+		const node* y = at(root_);
+		uint8_t  level  = 0;
+		bool	 is_net = addr.is_net();
+		uint32_t addr_i = (uint32_t)addr;
+		uint8_t  mask   = addr.mask();
+		while (y != nullptr)
 		{
-			if (!cur->left)
+			if (is_net && mask < level)
 			{
-				cur->left.reset(new node(addr, data));
-				++size_;
+				found = true;
+				instrumentation().lookup_end(probe, true, level);
+				return nullptr;
 			}
-			else
+			if (!is_net || (is_net && mask >= y->len))
 			{
-				insert(addr, data, cur->left, level + 1);
+				uint32_t cmp_mask = ~0;
+				cmp_mask <<= 32 - y->len;
+				if ((addr_i & cmp_mask) == y->prefix)
+				{
+					found = true;
+					instrumentation().lookup_end(probe, true, level + 1U);
+					return y;
+				}
 			}
+			if ((addr_i & (1 << (31 - level))) == 0)
+				y = at(y->left);
+			else
+				y = at(y->right);
+			++level;
 		}
-		else
+		instrumentation().lookup_end(probe, false, level);
+		return nullptr;
+	}
+
+	index_t new_node(const iptools::cidr_v4& addr, T&& data)
+	{
+		if (free_ == nil)
 		{
-			if (!cur->right)
-			{
-				cur->right.reset(new node(addr, data));
-				++size_;
-			}
-			else
-			{
-				insert(addr, data, cur->right, level + 1);
-			}
+			nodes_.emplace_back(addr);
+			this->data_put(nodes_.data(), nodes_.size() - 1, std::move(data));
+			return static_cast<index_t>(nodes_.size() - 1);
 		}
+		index_t rs = free_;
+		free_ = nodes_[rs].left;
+		nodes_[rs] = node(addr);
+		this->data_put(nodes_.data(), rs, std::move(data));
+		return rs;
 	}
 
-	void remove(const iptools::cidr_v4& toremove, node_ptr_t& cur, uint8_t level)
+	void free_node(index_t i)
 	{
-		if (!cur)
-			return;
-		if (toremove == cur->prefix)
+		this->data_at(nodes_.data(), i) = T();
+		nodes_[i].left = free_;
+		free_ = i;
+	}
+
+	void insert(iptools::cidr_v4 addr, T&& data, index_t cur)
+	{
+		for (uint8_t level = 0; ; ++level)
 		{
-			if (!cur->right && !cur->left)
+			node& y = nodes_[cur];
+			if (len(addr) >= y.len)
 			{
-				cur.reset(nullptr);
-				return;
-			}
-			if (!cur->right || (cur->left && (cur->left->len > cur->right->len)))
-			{
-				cur->swap(cur->left);
-				remove(toremove, cur->left, level+1);
+				y.swap(addr);
+				std::swap(this->data_at(nodes_.data(), cur), data);
 			}
-			else
+			if (len(addr) == y.len && ((uint32_t)addr>>(32-y.len) == y.prefix>>(32-y.len)))
+				return;
+			if (len(addr) == level)
+				return;
+			bool right = (((uint32_t)addr >> (31 - level)) & 1) != 0;
+			index_t next = right ? y.right : y.left;
+			if (next == nil)
 			{
-				cur->swap(cur->right);
-				remove(toremove, cur->right, level+1);
+				index_t child = new_node(addr, std::move(data)); // invalidates y
+				if (right)
+					nodes_[cur].right = child;
+				else
+					nodes_[cur].left = child;
+				++size_;
+				return;
 			}
-			return;
+			cur = next;
 		}
-		if (len(toremove) == level)
-			return;
-		if ((((uint32_t)toremove >> (31 - level)) & 1) == 0)
-			remove(toremove, cur->left, level+1);
-		else
-			remove(toremove, cur->right, level+1);
 	}
 
-	void walk(node_ptr_t& cur,
-	          int8_t level,
-	          std::function<void(node_ptr_t& node, uint8_t level, bool left)> fun_before,
-	          std::function<void(node_ptr_t& node, uint8_t level)> fun_after)
+	/**@brief visit every node in preorder, left subtree first
+	 *
+	 * fun(const node&, uint8_t level, bool left) is called for every node,
+	 * the root is reported as a right one.*/
+	template<class F> void walk(F&& fun) const
 	{
-		if (!cur)
-			 return;
-		if (cur->left)
+		struct item
 		{
-			if (fun_before)
-				fun_before(cur->left, level+1, true);
-			walk(cur->left, level+1, fun_before, fun_after);
-		}
-		if (cur->right)
+			index_t idx;
+			uint8_t level;
+			bool    left;
+		};
+		// at most one postponed right child per level
+		item   stack[34];
+		size_t top = 0;
+		if (root_ != nil)
+			stack[top++] = {root_, 0, false};
+		while (top > 0)
 		{
-			if (fun_before)
-				fun_before(cur->right, level+1, false);
-			walk(cur->right, level+1, fun_before, fun_after);
+			item cur = stack[--top];
+			const node& y = nodes_[cur.idx];
+			fun(y, cur.level, cur.left);
+			if (y.right != nil)
+				stack[top++] = {y.right, static_cast<uint8_t>(cur.level + 1), false};
+			if (y.left != nil)
+				stack[top++] = {y.left, static_cast<uint8_t>(cur.level + 1), true};
 		}
-		if (fun_after)
-			fun_after(cur, level);
 	}
 
-	void recurse_copy(const node_ptr_t& from, node_ptr_t& to)
+	static uint64_t next_generation()
 	{
-		if (from->right)
-		{
-			to->right.reset(new node(from->right->len, from->right->prefix, from->right->data));
-			recurse_copy(from->right, to->right);
-		}
-		if (from->left)
-		{
-			to->left.reset(new node(from->left->len, from->left->prefix, from->left->data));
-			recurse_copy(from->left, to->left);
-		}
+		static std::atomic<uint64_t> rs{0};
+		return rs.fetch_add(1, std::memory_order_relaxed) + 1;
 	}
 
-	node_ptr_t root_{nullptr};
-	size_t  size_{0};
+	std::vector<node, node_alloc_t> nodes_;
+	index_t  root_{nil};
+	index_t  free_{nil}; //!< released nodes chained by left
+	size_t   size_{0};
+	uint64_t generation_{0};
 };
 
+/**@brief Immutable image of the basic_lpfst
+ *
+ * Nodes are laid out in preorder in one array and linked by 32-bit
+ * indices, the data is kept in the separate array. Lookups have the same
+ * semantics as basic_lpfst::check.*/
+template<class T, class Alloc, class Instr>
+class basic_lpfst<T, Alloc, Instr>::snapshot
+{
+public:
+	using value_type = T;
+
+	snapshot() {}
+
+	size_t size() const { return data_.size(); }
+	bool empty() const { return nodes_.empty(); }
+
+	/**@return true if the address belongs any of the frozen CIDRs*/
+	bool check(const iptools::cidr_v4& addr, T& data) const
+	{
+		uint32_t i;
+		if (!lpfst_frozen_find(nodes_.data(), nodes_.size(), addr, i))
+			return false;
+		if (i != lpfst_frozen_node::nil)
+			data = data_[i];
+		return true;
+	}
+
+	/**@return true if the address belongs any of the frozen CIDRs
+	 * @param addr in host byte order*/
+	bool check(const uint32_t addr, T& data) const
+	{
+		uint32_t i = lpfst_frozen_find(nodes_.data(), nodes_.size(), addr);
+		if (i == lpfst_frozen_node::nil)
+			return false;
+		data = data_[i];
+		return true;
+	}
+
+	/**@brief nodes in preorder, the data of nodes()[i] is values()[i]*/
+	const lpfst_frozen_node* nodes() const { return nodes_.data(); }
+	const T* values() const { return data_.data(); }
+
+private:
+	std::vector<lpfst_frozen_node> nodes_;
+	std::vector<T>                 data_;
+
+friend class basic_lpfst;
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class T, class Alloc, class Instr> template<class It> void
+basic_lpfst<T, Alloc, Instr>::assign(It first, It last)
+{
+	struct item
+	{
+		uint32_t prefix;
+		uint8_t  len;
+		uint32_t data; //!< index in data
+	};
+	std::vector<item> items;
+	std::vector<T>    data;
+	for (; first != last; ++first)
+	{
+		uint8_t l = len(first->first);
+		items.push_back({l == 0 ? 0 : (uint32_t)first->first & (~0U << (32 - l)), l,
+		                 static_cast<uint32_t>(data.size())});
+		data.push_back((*first).second); // moved from move_iterator
+	}
+	// order by (prefix, len), the input order is kept for duplicates
+	radix_sort(items, 5, [](const item& i, size_t b)
+		{
+			return b == 0 ? i.len : static_cast<uint8_t>(i.prefix >> (8*(b - 1)));
+		});
+	size_t n = 0;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (n > 0 && items[n - 1].prefix == items[i].prefix && items[n - 1].len == items[i].len)
+			items[n - 1] = items[i];
+		else
+			items[n++] = items[i];
+	}
+	items.resize(n);
+
+	clear();
+	generation_ = next_generation();
+	nodes_.reserve(n);
+	this->data_reserve(n);
+	struct range
+	{
+		size_t  first;
+		size_t  last;
+		uint8_t level;
+		index_t parent;
+		bool    right;
+	};
+	std::vector<range> stack;
+	if (n > 0)
+		stack.push_back({0, n, 0, nil, false});
+	while (!stack.empty())
+	{
+		range r = stack.back();
+		stack.pop_back();
+		// the longest prefix takes the node, the rest stays sorted after it
+		size_t top = r.first;
+		for (size_t i = r.first + 1; i < r.last; ++i)
+			if (items[i].len > items[top].len)
+				top = i;
+		std::rotate(items.begin() + r.first, items.begin() + top, items.begin() + top + 1);
+		const item& y = items[r.first];
+		nodes_.emplace_back(y.len, y.prefix);
+		this->data_put(nodes_.data(), nodes_.size() - 1, std::move(data[y.data]));
+		index_t idx = static_cast<index_t>(nodes_.size() - 1);
+		if (r.parent == nil)
+			root_ = idx;
+		else if (r.right)
+			nodes_[r.parent].right = idx;
+		else
+			nodes_[r.parent].left = idx;
+		++size_;
+		// all the prefixes share r.level bits, the one of r.level length
+		// (the smallest) can't go deeper, the rest is split by the next bit
+		size_t begin = r.first + 1;
+		if (begin < r.last && items[begin].len == r.level)
+			++begin;
+		size_t split = begin;
+		while (split < r.last && ((items[split].prefix >> (31 - r.level)) & 1) == 0)
+			++split;
+		uint8_t next = static_cast<uint8_t>(r.level + 1);
+		if (split < r.last)
+			stack.push_back({split, r.last, next, idx, true});
+		if (begin < split)
+			stack.push_back({begin, split, next, idx, false});
+	}
+}
+
+template<class T, class Alloc, class Instr> lpfst_stats
+basic_lpfst<T, Alloc, Instr>::stats() const
+{
+	lpfst_stats rs;
+	rs.levels.assign(33, 0);
+	rs.leaves.assign(33, 0);
+	rs.lengths.assign(33, 0);
+	size_t visited = 0;
+	walk([&rs, &visited](const node& y, uint8_t level, bool)
+		{
+			++rs.nodes;
+			++rs.levels[level];
+			++rs.lengths[y.len];
+			if (y.left == nil && y.right == nil)
+				++rs.leaves[level];
+			if (level + 1U > rs.max_depth)
+				rs.max_depth = level + 1U;
+			visited += level + 1U;
+		});
+	for (index_t i = free_; i != nil; i = nodes_[i].left)
+		++rs.free_nodes;
+	rs.bytes = memory_footprint();
+	rs.avg_depth = rs.nodes ? (double)visited/rs.nodes : 0;
+	rs.levels.resize(rs.max_depth);
+	rs.leaves.resize(rs.max_depth);
+	return rs;
+}
+
+template<class T, class Alloc, class Instr> typename basic_lpfst<T, Alloc, Instr>::snapshot
+basic_lpfst<T, Alloc, Instr>::freeze() const
+{
+	snapshot rs;
+	if (root_ == nil)
+		return rs;
+	rs.nodes_.reserve(size_);
+	rs.data_.reserve(size_);
+	struct item
+	{
+		const node* from;
+		uint32_t    parent;
+		uint8_t     side;
+	};
+	std::vector<item> stack;
+	stack.push_back({&nodes_[root_], 0, 0});
+	while (!stack.empty())
+	{
+		item cur = stack.back();
+		stack.pop_back();
+		uint32_t idx = static_cast<uint32_t>(rs.nodes_.size());
+		if (idx != 0)
+			rs.nodes_[cur.parent].child[cur.side] = idx;
+		uint32_t mask = cur.from->len == 0 ? 0 : ~0U << (32 - cur.from->len);
+		rs.nodes_.push_back({cur.from->prefix, mask, {0, 0}});
+		rs.data_.push_back(value(*cur.from));
+		// left subtree goes right after its parent
+		if (cur.from->right != nil)
+			stack.push_back({&nodes_[cur.from->right], idx, 1});
+		if (cur.from->left != nil)
+			stack.push_back({&nodes_[cur.from->left], idx, 0});
+	}
+	return rs;
+}
+
 // preserve back compatibility
 class lpfst : public basic_lpfst<void*>
 {
@@ -320,10 +813,17 @@ public:
 	lpfst() : basic_lpfst() {}
 
 	lpfst(const lpfst& copy) : basic_lpfst(copy) { }
+	lpfst(lpfst&& other) noexcept : basic_lpfst(std::move(other)) { }
 
 	lpfst& operator=(const lpfst& copy)
 	{
-		basic_lpfst<void*>::operator=((basic_lpfst<void*>)copy);
+		basic_lpfst<void*>::operator=(copy);
+		return *this;
+	}
+
+	lpfst& operator=(lpfst&& other) noexcept
+	{
+		basic_lpfst<void*>::operator=(std::move(other));
 		return *this;
 	}
 
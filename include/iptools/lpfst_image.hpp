@@ -0,0 +1,209 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 17:48:03 */
+
+#pragma once
+#include "lpfst.hpp"
+#include <type_traits>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace iptools {
+
+/**@brief Header of the lpfst image file
+ *
+ * The header is followed by count lpfst_frozen_node (nodes_offset) and
+ * count values (values_offset). Nodes are linked by indices, so the image
+ * can be mapped at any address. Numbers are in the native byte order.*/
+struct lpfst_image_header
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t ENDIAN  = 0x01020304;
+
+	char     magic[8];      //!< "IPTLPFST"
+	uint32_t version;
+	uint32_t endian;
+	uint32_t node_size;
+	uint32_t value_size;
+	uint64_t count;
+	uint64_t nodes_offset;
+	uint64_t values_offset;
+	uint64_t file_size;
+};
+
+/**@brief write the snapshot image to the file
+ *
+ * The image is written to path.tmp and renamed, so processes mapping the
+ * old image are not affected.
+ * @param from basic_lpfst<T>::snapshot with trivially copyable T
+ * @return false on IO error*/
+template<class Snapshot> bool
+write_lpfst_image(const Snapshot& from, const char* path)
+{
+	using T = typename Snapshot::value_type;
+	static_assert(std::is_trivially_copyable<T>::value, "image data should be trivially copyable");
+
+	const uint64_t align = alignof(T) > 8 ? alignof(T) : 8;
+	lpfst_image_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "IPTLPFST", sizeof(header.magic));
+	header.version       = lpfst_image_header::VERSION;
+	header.endian        = lpfst_image_header::ENDIAN;
+	header.node_size     = sizeof(lpfst_frozen_node);
+	header.value_size    = sizeof(T);
+	header.count         = from.size();
+	header.nodes_offset  = sizeof(header);
+	header.values_offset = (header.nodes_offset + header.count*sizeof(lpfst_frozen_node) + align - 1)/align*align;
+	header.file_size     = header.values_offset + header.count*sizeof(T);
+
+	std::string tmp = std::string(path) + ".tmp";
+	int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	auto put = [fd](const void* buf, uint64_t len, uint64_t offset)
+		{
+			const char* p = static_cast<const char*>(buf);
+			while (len > 0)
+			{
+				ssize_t rs = ::pwrite(fd, p, len, offset);
+				if (rs <= 0)
+					return false;
+				p += rs;
+				len -= rs;
+				offset += rs;
+			}
+			return true;
+		};
+	bool ok = put(&header, sizeof(header), 0)
+		&& put(from.nodes(), header.count*sizeof(lpfst_frozen_node), header.nodes_offset)
+		&& put(from.values(), header.count*sizeof(T), header.values_offset)
+		&& ::ftruncate(fd, header.file_size) == 0;
+	ok = ::close(fd) == 0 && ok;
+	if (ok)
+		ok = ::rename(tmp.c_str(), path) == 0;
+	if (!ok)
+		::unlink(tmp.c_str());
+	return ok;
+}
+
+/**@brief Read-only lpfst mapped from the image file
+ *
+ * The file written by write_lpfst_image is queried in place, mapping
+ * costs no deserialization and the pages are shared by all the processes
+ * mapping the same file. Lookups have the same semantics as
+ * basic_lpfst::check.
+ *
+ * @warning the header is validated on open(), node links are not, map
+ * only trusted images*/
+template<class T>
+class basic_lpfst_image
+{
+	static_assert(std::is_trivially_copyable<T>::value, "image data should be trivially copyable");
+
+public:
+	basic_lpfst_image() {}
+	~basic_lpfst_image() { close(); }
+
+	basic_lpfst_image(const basic_lpfst_image&) = delete;
+	basic_lpfst_image& operator=(const basic_lpfst_image&) = delete;
+
+	/**@brief map the image file
+	 * @return false if the file can't be mapped or is not a valid image
+	 * of the same version, byte order and T size*/
+	bool open(const char* path);
+
+	void close()
+	{
+		if (map_)
+			::munmap(map_, map_size_);
+		map_ = nullptr;
+		map_size_ = 0;
+		nodes_ = nullptr;
+		values_ = nullptr;
+		count_ = 0;
+	}
+
+	size_t size() const { return count_; }
+	bool empty() const { return count_ == 0; }
+
+	/**@return true if the address belongs any of the CIDRs*/
+	bool check(const iptools::cidr_v4& addr, T& data) const
+	{
+		uint32_t i;
+		if (!lpfst_frozen_find(nodes_, count_, addr, i))
+			return false;
+		if (i != lpfst_frozen_node::nil)
+			memcpy(&data, values_ + i, sizeof(T));
+		return true;
+	}
+
+	/**@return true if the address belongs any of the CIDRs
+	 * @param addr in host byte order*/
+	bool check(const uint32_t addr, T& data) const
+	{
+		uint32_t i = lpfst_frozen_find(nodes_, count_, addr);
+		if (i == lpfst_frozen_node::nil)
+			return false;
+		memcpy(&data, values_ + i, sizeof(T));
+		return true;
+	}
+
+private:
+	void*                    map_{nullptr};
+	size_t                   map_size_{0};
+	const lpfst_frozen_node* nodes_{nullptr};
+	const T*                 values_{nullptr};
+	size_t                   count_{0};
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class T> bool
+basic_lpfst_image<T>::open(const char* path)
+{
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(lpfst_image_header))
+	{
+		::close(fd);
+		return false;
+	}
+	void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	const lpfst_image_header& h = *static_cast<const lpfst_image_header*>(map);
+	const uint64_t align = alignof(T) > 8 ? alignof(T) : 8;
+	bool valid = memcmp(h.magic, "IPTLPFST", sizeof(h.magic)) == 0
+		&& h.version == lpfst_image_header::VERSION
+		&& h.endian == lpfst_image_header::ENDIAN
+		&& h.node_size == sizeof(lpfst_frozen_node)
+		&& h.value_size == sizeof(T)
+		&& h.file_size == (uint64_t)st.st_size
+		&& h.count < lpfst_frozen_node::nil
+		&& h.nodes_offset == sizeof(lpfst_image_header)
+		&& h.values_offset % align == 0
+		&& h.values_offset >= h.nodes_offset + h.count*sizeof(lpfst_frozen_node)
+		&& h.values_offset + h.count*sizeof(T) <= h.file_size;
+	if (!valid)
+	{
+		::munmap(map, st.st_size);
+		return false;
+	}
+	map_      = map;
+	map_size_ = st.st_size;
+	count_    = h.count;
+	nodes_    = reinterpret_cast<const lpfst_frozen_node*>(static_cast<const char*>(map) + h.nodes_offset);
+	values_   = reinterpret_cast<const T*>(static_cast<const char*>(map) + h.values_offset);
+	return true;
+}
+
+} // namespace
@@ -0,0 +1,69 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 09:42:18 */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+namespace iptools {
+
+/**@brief Storage of the LPFST node data (basic_lpfst, basic_lpfst_v6)
+ *
+ * Data is addressed by the node index. Data not larger than the node index
+ * is kept inline (lpfst_payload<T, Alloc, false>): the matched node is
+ * already in the cache. Larger data goes to the array parallel to the
+ * nodes, so the node size doesn't depend on T and more nodes fit a cache
+ * line, the data is touched only at the match.
+ *
+ * The node derives from slot.*/
+template<class T, class Alloc, bool Separate = (sizeof(T) > sizeof(uint32_t))>
+class lpfst_payload;
+
+template<class T, class Alloc>
+class lpfst_payload<T, Alloc, false>
+{
+public:
+	struct slot
+	{
+		T data{};
+	};
+
+	template<class Node> T& data_at(Node* nodes, size_t i) { return nodes[i].data; }
+	template<class Node> const T& data_at(const Node* nodes, size_t i) const { return nodes[i].data; }
+
+	/**@brief set the data of the node, i may be the just appended one*/
+	template<class Node> void data_put(Node* nodes, size_t i, T&& data) { nodes[i].data = std::move(data); }
+
+	void data_reserve(size_t) {}
+	void data_clear() {}
+	size_t data_bytes() const { return 0; }
+};
+
+template<class T, class Alloc>
+class lpfst_payload<T, Alloc, true>
+{
+public:
+	struct slot {};
+
+	template<class Node> T& data_at(Node*, size_t i) { return data_[i]; }
+	template<class Node> const T& data_at(const Node*, size_t i) const { return data_[i]; }
+
+	template<class Node> void data_put(Node*, size_t i, T&& data)
+	{
+		if (i == data_.size())
+			data_.push_back(std::move(data));
+		else
+			data_[i] = std::move(data);
+	}
+
+	void data_reserve(size_t n) { data_.reserve(n); }
+	void data_clear() { data_.clear(); }
+	size_t data_bytes() const { return data_.capacity()*sizeof(T); }
+
+private:
+	std::vector<T, Alloc> data_; //!< data of the node i is data_[i]
+};
+
+} // namespace
@@ -0,0 +1,27 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 23:10:27 */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace iptools {
+
+/**@brief Structure of the LPFST (basic_lpfst::stats, basic_lpfst_v6::stats)
+ *
+ * Level of the root is 0, lookup of the prefix at level i visits i+1
+ * nodes. Histograms are indexed by level or prefix length.*/
+struct lpfst_stats
+{
+	size_t nodes{0};      //!< nodes in the tree, one per stored prefix
+	size_t free_nodes{0}; //!< released nodes kept for reuse
+	size_t bytes{0};      //!< allocated by the tree, heap owned by T is not counted
+	size_t max_depth{0};  //!< nodes visited by the longest lookup
+	double avg_depth{0};  //!< nodes visited to find a stored prefix, on average
+
+	std::vector<size_t> levels;  //!< nodes at every level
+	std::vector<size_t> leaves;  //!< leaves at every level (unsuccessful lookup depths)
+	std::vector<size_t> lengths; //!< stored prefixes of every length
+};
+
+} // namespace
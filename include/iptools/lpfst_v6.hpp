@@ -3,10 +3,17 @@
 
 #pragma once
 #include "cidr.hpp"
+#include "compiler.hpp"
+#include "radix_sort.hpp"
+#include "lpfst_stats.hpp"
+#include "lpfst_payload.hpp"
+#include "instrumentation.hpp"
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <sstream>
-#include <functional>
+#include <memory>
+#include <atomic>
 
 namespace iptools {
 
@@ -15,166 +22,367 @@ using in6_addr_t = std::array<uint8_t, 16>;
 /**@brief Data structure allows to add some CIDR networks and check if
  * the given address belongs to any of them.
  *
- * Based on Longest Prefix First Search Tree (LPFST)*/
-template <class T> class basic_lpfst_v6
+ * Based on Longest Prefix First Search Tree (LPFST). Nodes are kept in one
+ * arena (vector allocated with Alloc) and linked by 32-bit indices, so
+ * building the tree does not allocate per node, clear() and destruction
+ * release the storage at once and copying is a block copy.
+ *
+ * Node layout is chosen by lpfst_payload as in basic_lpfst: T larger than
+ * 4 bytes goes to the parallel array and the node takes 28 bytes, T up to
+ * 4 bytes stays inline (32 bytes for a 4-byte T, two per cache line, 28
+ * for 1 or 2 bytes).
+ *
+ * Instr is the lookup instrumentation policy (see no_instrumentation,
+ * lookup_metrics) notified about every find() and check().*/
+template <class T, class Alloc = std::allocator<T>, class Instr = no_instrumentation>
+class basic_lpfst_v6 : private Instr, private lpfst_payload<T, Alloc>
 {
 public:
-	basic_lpfst_v6()
-		: root_{nullptr}
-		, size_(0)
-	{}
+	using value_type = T;
+
+	basic_lpfst_v6() {}
+
+	virtual ~basic_lpfst_v6() {}
 
-	virtual ~basic_lpfst_v6()
+	basic_lpfst_v6(const basic_lpfst_v6& copy) = default;
+	basic_lpfst_v6& operator=(const basic_lpfst_v6& copy) = default;
+
+	/**@brief take the nodes of other, it is left empty*/
+	basic_lpfst_v6(basic_lpfst_v6&& other) noexcept
+		: Instr(std::move(static_cast<Instr&>(other)))
+		, lpfst_payload<T, Alloc>(std::move(other))
+		, nodes_(std::move(other.nodes_))
+		, root_(other.root_)
+		, free_(other.free_)
+		, size_(other.size_)
+		, generation_(other.generation_)
 	{
-		clear();
+		other.clear();
 	}
 
-	basic_lpfst_v6(const basic_lpfst_v6& copy)
+	basic_lpfst_v6& operator=(basic_lpfst_v6&& other) noexcept
 	{
-		operator=(copy);
+		if (this != &other)
+		{
+			Instr::operator=(std::move(static_cast<Instr&>(other)));
+			nodes_ = std::move(other.nodes_);
+			lpfst_payload<T, Alloc>::operator=(std::move(other));
+			root_  = other.root_;
+			free_  = other.free_;
+			size_  = other.size_;
+			generation_ = other.generation_;
+			other.clear();
+		}
+		return *this;
 	}
 
-	basic_lpfst_v6& operator=(const basic_lpfst_v6& copy)
+	/**@brief build the tree from the range of (cidr_v6, T) pairs, see assign()*/
+	template <class It> basic_lpfst_v6(It first, It last)
 	{
-		clear();
-		if (!copy.root_)
-			return *this;
-		root_.reset(new node(copy.root_->len, copy.root_->prefix, copy.root_->data));
-		recurse_copy(copy.root_, root_);
-		size_ = copy.size_;
-		return *this;
+		assign(first, last);
 	}
 
+	/**@brief replace the content with the range of (cidr_v6, T) pairs
+	 *
+	 * The pairs are radix sorted and the tree is built top-down over the
+	 * sorted array with one sequential pass per level, so the build takes
+	 * O(128n) without swapping the data along the insertion paths. The last
+	 * data is kept for duplicates. A prefix is dropped (as insert() does)
+	 * if the longer one takes the node at the level equal to its length.*/
+	template <class It> void assign(It first, It last);
+
 	size_t size() const
 	{
 		return size_;
 	}
 
+	/**@brief changed by every modification, trees with the same generation
+	 * have the same content (one is a copy of the other)*/
+	uint64_t generation() const
+	{
+		return generation_;
+	}
+
+	/**@brief data is moved along the insertion path, T may be move-only*/
 	void insert(iptools::cidr_v6 addr, T data)
 	{
-		if (!root_)
+		generation_ = next_generation();
+		if (root_ == nil)
 		{
-			root_.reset(new node(addr, data));
+			root_ = new_node(addr, std::move(data));
 			size_ = 1;
 			return;
 		}
-		insert(addr, data, root_, 0);
+		insert(addr, std::move(data), root_);
 	}
 
-	void remove(const iptools::cidr_v6& addr)
+	/**@brief insert T constructed from args*/
+	template <class... Args> void emplace(iptools::cidr_v6 addr, Args&&... args)
 	{
-		remove(addr, root_, 0);
-		--size_;
+		insert(addr, T(std::forward<Args>(args)...));
 	}
 
-	/**@return true if the address belongs any of the inserted CIDRs*/
-	bool check(const iptools::cidr_v6& addr, T& data) const
+	void remove(const iptools::cidr_v6& toremove)
 	{
-		node*    y      = root_.get();
-		uint8_t  level  = 0;
-		bool     is_net = addr.is_net();
-		uint8_t  mask   = addr.mask();
-		while (y != nullptr)
+		index_t* link = &root_;
+		for (uint8_t level = 0; *link != nil; ++level)
 		{
-			if (is_net && mask < level)
-				return true;
-			if (!is_net || (is_net && mask >= y->len))
+			node& y = nodes_[*link];
+			if (toremove.has_prefix(y.prefix, y.len) && y.len == toremove.mask())
+				break;
+			if (len(toremove) == level)
+				return;
+			if (!toremove.check_bit(127-level))
+				link = &y.left;
+			else
+				link = &y.right;
+		}
+		if (*link == nil)
+			return;
+		--size_;
+		generation_ = next_generation();
+		// push the node down to the leaf swapping with the longest child
+		for (;;)
+		{
+			index_t cur = *link;
+			node&   y   = nodes_[cur];
+			if (y.right == nil && y.left == nil)
 			{
-				if (addr.has_prefix(y->prefix, y->len))
-				{
-					data = y->data;
-					return true;
-				}
+				free_node(*link);
+				*link = nil;
+				return;
+			}
+			if (y.right == nil || (y.left != nil && (nodes_[y.left].len > nodes_[y.right].len)))
+			{
+				y.swap(nodes_[y.left]);
+				std::swap(this->data_at(nodes_.data(), cur), this->data_at(nodes_.data(), y.left));
+				link = &y.left;
 			}
-			if (!addr.check_bit(127-level))
-				y = y->left.get();
 			else
-				y = y->right.get();
-			++level;
+			{
+				y.swap(nodes_[y.right]);
+				std::swap(this->data_at(nodes_.data(), cur), this->data_at(nodes_.data(), y.right));
+				link = &y.right;
+			}
 		}
-		return false;
+	}
+
+	/**@return true if the address belongs any of the inserted CIDRs*/
+	bool check(const iptools::cidr_v6& addr, T& data) const
+	{
+		bool        found = false;
+		const node* y     = match(addr, found);
+		if (y)
+			data = value(*y);
+		return found;
 	}
 
 	/**@return true if the address belongs any of the inserted CIDRs
 	 * @param addr in host byte order*/
 	bool check(const in6_addr_t addr, T& data) const
 	{
-		node*    y     = root_.get();
-		uint8_t  level = 0;
+		const T* rs = find(addr);
+		if (!rs)
+			return false;
+		data = *rs;
+		return true;
+	}
+
+	/**@brief check() without copying the data
+	 * @return data of the longest matching prefix or nullptr, also nullptr
+	 * if the network only covers some of the inserted CIDRs (check()
+	 * returns true without data in this case). The pointer is valid until
+	 * the tree is modified.*/
+	const T* find(const iptools::cidr_v6& addr) const
+	{
+		bool        found = false;
+		const node* y     = match(addr, found);
+		return y ? &value(*y) : nullptr;
+	}
+
+	const T* find(const in6_addr_t& addr) const
+	{
+		typename Instr::probe probe = instrumentation().lookup_start();
+		unsigned              visited;
+		const T*              rs = find(addr, visited);
+		instrumentation().lookup_end(probe, rs != nullptr, visited);
+		return rs;
+	}
+
+	/**@brief find() not reported to the instrumentation
+	 * @param visited set to the number of visited nodes*/
+	const T* find(const in6_addr_t& addr, unsigned& visited) const
+	{
+		const node* y     = at(root_);
+		uint8_t     level = 0;
 		while (y != nullptr)
 		{
 			if (has_prefix(addr, y->prefix, y->len))
 			{
-				data = y->data;
-				return true;
+				visited = level + 1U;
+				return &value(*y);
 			}
 			if (!check_bit(addr, 127-level))
-				y = y->left.get();
+				y = at(y->left);
 			else
-				y = y->right.get();
+				y = at(y->right);
 			++level;
 		}
-		return false;
+		visited = level;
+		return nullptr;
+	}
+
+	/**@brief check n addresses at once
+	 *
+	 * Lookups are advanced in groups one level at a time and the next node
+	 * of every lookup is prefetched before it is touched, so the cache
+	 * misses of the group overlap.
+	 * @param found found[i] is set to 1 if addrs[i] belongs any of the
+	 * inserted CIDRs (out[i] is assigned only in this case), 0 otherwise*/
+	void check_batch(const in6_addr_t* addrs, size_t n, T* out, uint8_t* found) const
+	{
+		const size_t group = 16;
+		const node*  cur[group];
+		unsigned     visited[group];
+		for (size_t base = 0; base < n; base += group)
+		{
+			size_t cnt    = n - base < group ? n - base : group;
+			size_t active = 0;
+			for (size_t i = 0; i < cnt; ++i)
+			{
+				cur[i]          = at(root_);
+				found[base + i] = 0;
+				visited[i]      = 0;
+				if (cur[i])
+					++active;
+			}
+			for (uint8_t level = 0; active > 0; ++level)
+			{
+				for (size_t i = 0; i < cnt; ++i)
+				{
+					const node* y = cur[i];
+					if (!y)
+						continue;
+					++visited[i];
+					const in6_addr_t& addr = addrs[base + i];
+					if (has_prefix(addr, y->prefix, y->len))
+					{
+						out[base + i]   = value(*y);
+						found[base + i] = 1;
+						y               = nullptr;
+					}
+					else if (!check_bit(addr, 127-level))
+					{
+						y = at(y->left);
+					}
+					else
+					{
+						y = at(y->right);
+					}
+					if (y)
+						prefetch(y);
+					else
+						--active;
+					cur[i] = y;
+				}
+			}
+			for (size_t i = 0; i < cnt; ++i)
+				instrumentation().lookup_end(typename Instr::probe(), found[base + i] != 0, visited[i]);
+		}
 	}
 
 	bool empty() const
 	{
-		return !(bool)root_;
+		return root_ == nil;
 	}
 
-	void clear()
+	/**@brief the lookup instrumentation policy with its counters*/
+	const Instr& instrumentation() const
+	{
+		return *this;
+	}
+
+	Instr& instrumentation()
+	{
+		return *this;
+	}
+
+	/**@brief call fun(cidr_v6, const T&) for every stored prefix*/
+	template <class F> void for_each_prefix(F&& fun) const
 	{
-		walk(root_, 0, nullptr, [](node_ptr_t& cur, uint8_t level) {
-			cur->left.reset(nullptr);
-			cur->right.reset(nullptr);
+		walk([this, &fun](const node& y, uint8_t, bool) {
+			fun(iptools::cidr_v6(y.prefix, y.len), value(y));
 		});
-		root_.reset(nullptr);
+	}
+
+	/**@brief walk the tree and collect its structure and memory usage*/
+	lpfst_stats stats() const;
+
+	/**@brief bytes allocated by the tree (stats().bytes without the walk),
+	 * heap owned by T is not counted*/
+	size_t memory_footprint() const
+	{
+		return sizeof(*this) + nodes_.capacity()*sizeof(node) + this->data_bytes();
+	}
+
+	/**@brief remove all the prefixes, allocated storage is kept for reuse*/
+	void clear()
+	{
+		nodes_.clear();
+		this->data_clear();
+		root_ = nil;
+		free_ = nil;
 		size_ = 0;
+		// all the empty trees are equal
+		generation_ = 0;
 	}
 
-	std::string print()
+	std::string print() const
 	{
-		if (!root_)
-			return {};
 		std::stringstream ss;
-		ss << root_->prefix << "/" << (int)root_->len << " " << root_->data;
-		walk(
-			root_, 0,
-			[&ss](node_ptr_t& cur, uint8_t level, bool left) {
-				ss << std::endl << (int)level;
-				for (uint8_t i = 0; i < level; ++i)
-					ss << "  ";
-				ss << (left ? "[-] " : "[+] ") << cur->prefix << "/" << (int)cur->len << " " << cur->data;
-			},
-			nullptr);
+		char tmp[iptools::cidr_v6::max_str_len];
+		walk([this, &ss, &tmp](const node& cur, uint8_t level, bool left) {
+			char* end = iptools::cidr_v6(cur.prefix, cur.len).to_chars(tmp, tmp + sizeof(tmp));
+			if (level == 0)
+			{
+				ss.write(tmp, end - tmp) << " " << value(cur);
+				return;
+			}
+			ss << std::endl << (int)level;
+			for (uint8_t i = 0; i < level; ++i)
+				ss << "  ";
+			ss << (left ? "[-] " : "[+] ");
+			ss.write(tmp, end - tmp) << " " << value(cur);
+		});
 		return ss.str();
 	}
 
 protected:
 	struct node;
-	using node_ptr_t = std::unique_ptr<node>;
+	using index_t      = uint32_t;
+	using node_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+
+	static const index_t nil = 0xFFFFFFFF;
 
 	inline uint8_t len(const iptools::cidr_v6 addr)
 	{
 		return addr.is_net() ? addr.mask() : 128;
 	}
 
-	struct node
+	struct node : lpfst_payload<T, Alloc>::slot
 	{
-		node(uint8_t len, in6_addr_t prefix, T data)
+		node(uint8_t len, in6_addr_t prefix)
 			: len(len > 128 ? 128 : len)
 			, prefix(prefix)
-			, data(data)
-			, left(nullptr)
-			, right(nullptr)
+			, left(nil)
+			, right(nil)
 		{}
 
-		node(const iptools::cidr_v6& addr, T data)
+		explicit node(const iptools::cidr_v6& addr)
 			: len(addr.is_net() ? addr.mask() : (uint8_t)128)
 			, prefix(addr)
-			, data(data)
-			, left(nullptr)
-			, right(nullptr)
+			, left(nil)
+			, right(nil)
 		{}
 
 		template <typename I> void swap(I& x, I& y)
@@ -184,21 +392,14 @@ protected:
 			x = x ^ y;
 		}
 
-		void swap(node_ptr_t& rhv)
+		void swap(node& rhv)
 		{
-			swap(len, rhv->len);
-			prefix.swap(rhv->prefix);
-			T tmp     = data;
-			data      = rhv->data;
-			rhv->data = tmp;
+			swap(len, rhv.len);
+			prefix.swap(rhv.prefix);
 		}
 
-		void swap(iptools::cidr_v6& addr, T& data)
+		void swap(iptools::cidr_v6& addr)
 		{
-			T aux      = this->data;
-			this->data = data;
-			data       = aux;
-
 			iptools::cidr_v6 aux_addr(prefix, len);
 			len    = addr.is_net() ? addr.mask() : 128;
 			prefix = addr;
@@ -207,117 +408,267 @@ protected:
 
 		uint8_t                  len;
 		in6_addr_t               prefix;
-		T                        data;
-		node_ptr_t               left;
-		node_ptr_t               right;
+		index_t                  left;
+		index_t                  right;
 	};
 
-	void insert(iptools::cidr_v6 addr, T data, node_ptr_t& cur, uint8_t level)
+	const node* at(index_t i) const
 	{
-		if (len(addr) >= cur->len)
-			cur->swap(addr, data);
-		if (len(addr) == cur->len && addr.has_prefix(cur->prefix, cur->len))
-			return;
-		if (len(addr) == level)
-			return;
-		if (!addr.check_bit(127-level))
+		return i == nil ? nullptr : &nodes_[i];
+	}
+
+	/**@brief data of the node*/
+	const T& value(const node& y) const
+	{
+		return this->data_at(nodes_.data(), &y - nodes_.data());
+	}
+
+	/**@brief the node matching the network, found is set to true also if
+	 * the network covers a subtree (nullptr is returned then)*/
+	const node* match(const iptools::cidr_v6& addr, bool& found) const
+	{
+		typename Instr::probe probe  = instrumentation().lookup_start();
+		const node*           y      = at(root_);
+		uint8_t               level  = 0;
+		bool                  is_net = addr.is_net();
+		uint8_t               mask   = addr.mask();
+		while (y != nullptr)
 		{
-			if (!cur->left)
+			if (is_net && mask < level)
 			{
-				cur->left.reset(new node(addr, data));
-				++size_;
+				found = true;
+				instrumentation().lookup_end(probe, true, level);
+				return nullptr;
 			}
-			else
+			if (!is_net || (is_net && mask >= y->len))
 			{
-				insert(addr, data, cur->left, level + 1);
+				if (addr.has_prefix(y->prefix, y->len))
+				{
+					found = true;
+					instrumentation().lookup_end(probe, true, level + 1U);
+					return y;
+				}
 			}
+			if (!addr.check_bit(127-level))
+				y = at(y->left);
+			else
+				y = at(y->right);
+			++level;
 		}
-		else
+		instrumentation().lookup_end(probe, false, level);
+		return nullptr;
+	}
+
+	index_t new_node(const iptools::cidr_v6& addr, T&& data)
+	{
+		if (free_ == nil)
 		{
-			if (!cur->right)
-			{
-				cur->right.reset(new node(addr, data));
-				++size_;
-			}
-			else
-			{
-				insert(addr, data, cur->right, level + 1);
-			}
+			nodes_.emplace_back(addr);
+			this->data_put(nodes_.data(), nodes_.size() - 1, std::move(data));
+			return static_cast<index_t>(nodes_.size() - 1);
 		}
+		index_t rs = free_;
+		free_      = nodes_[rs].left;
+		nodes_[rs] = node(addr);
+		this->data_put(nodes_.data(), rs, std::move(data));
+		return rs;
 	}
 
-	void remove(const iptools::cidr_v6& toremove, node_ptr_t& cur, uint8_t level)
+	void free_node(index_t i)
 	{
-		if (!cur)
-			return;
-		if (toremove.has_prefix(cur->prefix, cur->len) && cur->len == toremove.mask())
+		this->data_at(nodes_.data(), i) = T();
+		nodes_[i].left = free_;
+		free_          = i;
+	}
+
+	void insert(iptools::cidr_v6 addr, T&& data, index_t cur)
+	{
+		for (uint8_t level = 0;; ++level)
 		{
-			if (!cur->right && !cur->left)
-			{
-				cur.reset(nullptr);
-				return;
-			}
-			if (!cur->right || (cur->left && (cur->left->len > cur->right->len)))
+			node& y = nodes_[cur];
+			if (len(addr) >= y.len)
 			{
-				cur->swap(cur->left);
-				remove(toremove, cur->left, level + 1);
+				y.swap(addr);
+				std::swap(this->data_at(nodes_.data(), cur), data);
 			}
-			else
+			if (len(addr) == y.len && addr.has_prefix(y.prefix, y.len))
+				return;
+			if (len(addr) == level)
+				return;
+			bool    right = addr.check_bit(127-level);
+			index_t next  = right ? y.right : y.left;
+			if (next == nil)
 			{
-				cur->swap(cur->right);
-				remove(toremove, cur->right, level + 1);
+				index_t child = new_node(addr, std::move(data)); // invalidates y
+				if (right)
+					nodes_[cur].right = child;
+				else
+					nodes_[cur].left = child;
+				++size_;
+				return;
 			}
-			return;
+			cur = next;
 		}
-		if (len(toremove) == level)
-			return;
-		if (!toremove.check_bit(127-level))
-			remove(toremove, cur->left, level + 1);
-		else
-			remove(toremove, cur->right, level + 1);
 	}
 
-	void walk(node_ptr_t&                                               cur,
-		int8_t                                                          level,
-		std::function<void(node_ptr_t& node, uint8_t level, bool left)> fun_before,
-		std::function<void(node_ptr_t& node, uint8_t level)>            fun_after)
+	/**@brief visit every node in preorder, left subtree first
+	 *
+	 * fun(const node&, uint8_t level, bool left) is called for every node,
+	 * the root is reported as a right one.*/
+	template <class F> void walk(F&& fun) const
 	{
-		if (!cur)
-			return;
-		if (cur->left)
+		struct item
 		{
-			if (fun_before)
-				fun_before(cur->left, level + 1, true);
-			walk(cur->left, level + 1, fun_before, fun_after);
-		}
-		if (cur->right)
+			index_t idx;
+			uint8_t level;
+			bool    left;
+		};
+		// at most one postponed right child per level
+		item   stack[130];
+		size_t top = 0;
+		if (root_ != nil)
+			stack[top++] = {root_, 0, false};
+		while (top > 0)
 		{
-			if (fun_before)
-				fun_before(cur->right, level + 1, false);
-			walk(cur->right, level + 1, fun_before, fun_after);
+			item        cur = stack[--top];
+			const node& y   = nodes_[cur.idx];
+			fun(y, cur.level, cur.left);
+			if (y.right != nil)
+				stack[top++] = {y.right, static_cast<uint8_t>(cur.level + 1), false};
+			if (y.left != nil)
+				stack[top++] = {y.left, static_cast<uint8_t>(cur.level + 1), true};
 		}
-		if (fun_after)
-			fun_after(cur, level);
 	}
 
-	void recurse_copy(const node_ptr_t& from, node_ptr_t& to)
+	static uint64_t next_generation()
 	{
-		if (from->right)
-		{
-			to->right.reset(new node(from->right->len, from->right->prefix, from->right->data));
-			recurse_copy(from->right, to->right);
-		}
-		if (from->left)
-		{
-			to->left.reset(new node(from->left->len, from->left->prefix, from->left->data));
-			recurse_copy(from->left, to->left);
-		}
+		static std::atomic<uint64_t> rs{0};
+		return rs.fetch_add(1, std::memory_order_relaxed) + 1;
 	}
 
-	node_ptr_t root_{nullptr};
-	size_t     size_{0};
+	std::vector<node, node_alloc_t> nodes_;
+	index_t                         root_{nil};
+	index_t                         free_{nil}; //!< released nodes chained by left
+	size_t                          size_{0};
+	uint64_t                        generation_{0};
 };
 
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template <class T, class Alloc, class Instr> lpfst_stats
+basic_lpfst_v6<T, Alloc, Instr>::stats() const
+{
+	lpfst_stats rs;
+	rs.levels.assign(129, 0);
+	rs.leaves.assign(129, 0);
+	rs.lengths.assign(129, 0);
+	size_t visited = 0;
+	walk([&rs, &visited](const node& y, uint8_t level, bool) {
+		++rs.nodes;
+		++rs.levels[level];
+		++rs.lengths[y.len];
+		if (y.left == nil && y.right == nil)
+			++rs.leaves[level];
+		if (level + 1U > rs.max_depth)
+			rs.max_depth = level + 1U;
+		visited += level + 1U;
+	});
+	for (index_t i = free_; i != nil; i = nodes_[i].left)
+		++rs.free_nodes;
+	rs.bytes     = memory_footprint();
+	rs.avg_depth = rs.nodes ? (double)visited/rs.nodes : 0;
+	rs.levels.resize(rs.max_depth);
+	rs.leaves.resize(rs.max_depth);
+	return rs;
+}
+
+template <class T, class Alloc, class Instr> template <class It> void
+basic_lpfst_v6<T, Alloc, Instr>::assign(It first, It last)
+{
+	struct item
+	{
+		in6_addr_t prefix;
+		uint8_t    len;
+		uint32_t   data; //!< index in data
+	};
+	std::vector<item> items;
+	std::vector<T>    data;
+	for (; first != last; ++first)
+	{
+		uint8_t    l      = len(first->first);
+		in6_addr_t prefix = first->first;
+		for (uint8_t i = 0, rest = l; i < 16; ++i, rest = rest > 8 ? rest - 8 : 0)
+			prefix[i] &= static_cast<uint8_t>(rest >= 8 ? 0xFF : 0xFF00 >> rest);
+		items.push_back({prefix, l, static_cast<uint32_t>(data.size())});
+		data.push_back((*first).second); // moved from move_iterator
+	}
+	// order by (prefix, len), the input order is kept for duplicates
+	radix_sort(items, 17, [](const item& i, size_t b) {
+		return b == 0 ? i.len : i.prefix[16 - b];
+	});
+	size_t n = 0;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		if (n > 0 && items[n - 1].prefix == items[i].prefix && items[n - 1].len == items[i].len)
+			items[n - 1] = items[i];
+		else
+			items[n++] = items[i];
+	}
+	items.resize(n);
+
+	clear();
+	generation_ = next_generation();
+	nodes_.reserve(n);
+	this->data_reserve(n);
+	struct range
+	{
+		size_t  first;
+		size_t  last;
+		uint8_t level;
+		index_t parent;
+		bool    right;
+	};
+	std::vector<range> stack;
+	if (n > 0)
+		stack.push_back({0, n, 0, nil, false});
+	while (!stack.empty())
+	{
+		range r = stack.back();
+		stack.pop_back();
+		// the longest prefix takes the node, the rest stays sorted after it
+		size_t top = r.first;
+		for (size_t i = r.first + 1; i < r.last; ++i)
+			if (items[i].len > items[top].len)
+				top = i;
+		std::rotate(items.begin() + r.first, items.begin() + top, items.begin() + top + 1);
+		const item& y = items[r.first];
+		nodes_.emplace_back(y.len, y.prefix);
+		this->data_put(nodes_.data(), nodes_.size() - 1, std::move(data[y.data]));
+		index_t idx = static_cast<index_t>(nodes_.size() - 1);
+		if (r.parent == nil)
+			root_ = idx;
+		else if (r.right)
+			nodes_[r.parent].right = idx;
+		else
+			nodes_[r.parent].left = idx;
+		++size_;
+		// all the prefixes share r.level bits, the one of r.level length
+		// (the smallest) can't go deeper, the rest is split by the next bit
+		size_t begin = r.first + 1;
+		if (begin < r.last && items[begin].len == r.level)
+			++begin;
+		size_t split = begin;
+		while (split < r.last && !check_bit(items[split].prefix, 127 - r.level))
+			++split;
+		uint8_t next = static_cast<uint8_t>(r.level + 1);
+		if (split < r.last)
+			stack.push_back({split, r.last, next, idx, true});
+		if (begin < split)
+			stack.push_back({begin, split, next, idx, false});
+	}
+}
+
 // preserve back compatibility
 class lpfst_v6 : public basic_lpfst_v6<void*>
 {
@@ -330,9 +681,19 @@ public:
 		: basic_lpfst_v6(copy)
 	{}
 
+	lpfst_v6(lpfst_v6&& other) noexcept
+		: basic_lpfst_v6(std::move(other))
+	{}
+
 	lpfst_v6& operator=(const lpfst_v6& copy)
 	{
-		basic_lpfst_v6<void*>::operator=((basic_lpfst_v6<void*>)copy);
+		basic_lpfst_v6<void*>::operator=(copy);
+		return *this;
+	}
+
+	lpfst_v6& operator=(lpfst_v6&& other) noexcept
+	{
+		basic_lpfst_v6<void*>::operator=(std::move(other));
 		return *this;
 	}
 
@@ -0,0 +1,30 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 19:55:30 */
+
+#pragma once
+
+namespace iptools {
+
+/**@brief result of the address parsing*/
+enum class parse_error
+{
+	ok = 0,
+	empty,        //!< nothing to parse
+	bad_address,  //!< malformed address part
+	bad_mask      //!< malformed or too long mask
+};
+
+inline const char*
+parse_error_str(parse_error err)
+{
+	switch (err)
+	{
+		case parse_error::ok:          return "ok";
+		case parse_error::empty:       return "empty string";
+		case parse_error::bad_address: return "malformed address";
+		case parse_error::bad_mask:    return "malformed mask";
+	}
+	return "unknown error";
+}
+
+} // namespace
@@ -0,0 +1,244 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 11:02:15 */
+
+#pragma once
+#include "compiler.hpp"
+#include "lpfst.hpp"
+#include "lpfst_v6.hpp"
+#include <vector>
+#include <algorithm>
+
+namespace iptools {
+
+/**@brief Key operations needed by the multibit trie*/
+template<class Key> struct multibit_key;
+
+template<> struct multibit_key<uint32_t>
+{
+	static const uint8_t width = 32;
+
+	static uint32_t key(const iptools::cidr_v4& addr) { return addr; }
+	static uint8_t  len(const iptools::cidr_v4& addr) { return addr.is_net() ? addr.mask() : 32; }
+
+	/**@brief n (<= 8) bits starting from offset (MSB first), zero padded*/
+	static uint8_t chunk(uint32_t key, uint8_t offset, uint8_t n)
+	{
+		return static_cast<uint8_t>((((uint64_t)key << 32) << offset) >> (64 - n));
+	}
+
+	static uint32_t net(uint32_t key, uint8_t len)
+	{
+		return len == 0 ? 0 : key >> (32 - len) << (32 - len);
+	}
+};
+
+template<> struct multibit_key<in6_addr_t>
+{
+	static const uint8_t width = 128;
+
+	static in6_addr_t key(const iptools::cidr_v6& addr) { return addr; }
+	static uint8_t    len(const iptools::cidr_v6& addr) { return addr.is_net() ? addr.mask() : 128; }
+
+	/**@brief n (<= 8) bits starting from offset (MSB first), zero padded*/
+	static uint8_t chunk(const in6_addr_t& key, uint8_t offset, uint8_t n)
+	{
+		uint8_t  byte = offset / 8;
+		uint16_t w = (uint16_t)(key[byte] << 8) | (byte < 15 ? key[byte + 1] : 0);
+		return static_cast<uint8_t>(((uint16_t)(w << (offset % 8))) >> (16 - n));
+	}
+
+	static in6_addr_t net(in6_addr_t key, uint8_t len)
+	{
+		for (uint8_t i = 0; i < 16; ++i, len = len > 8 ? len - 8 : 0)
+			key[i] &= static_cast<uint8_t>(len >= 8 ? 0xFF : 0xFF00 >> len);
+		return key;
+	}
+};
+
+/**@brief Multibit trie with popcount compressed nodes (Poptrie)
+ *
+ * Every node consumes Stride bits of the address. Children and leaves of
+ * the node are stored contiguously and addressed by the popcount of the
+ * node bitmaps, equal neighbouring leaves are stored once. IPv4 lookup
+ * takes at most 6 node visits, IPv6 - 22 (with the default stride).
+ *
+ * The trie is immutable, build it from basic_lpfst or basic_lpfst_v6.*/
+template<class Key, class T, uint8_t Stride = 6>
+class multibit_trie
+{
+	static_assert(Stride > 0 && Stride <= 6, "stride should fit into 64-bit bitmap");
+	using traits = multibit_key<Key>;
+
+public:
+	multibit_trie() { build({}); }
+
+	/**@param from any table with for_each_prefix (basic_lpfst, basic_lpfst_v6)*/
+	template<class Table> explicit multibit_trie(const Table& from)
+	{
+		std::vector<prefix> list;
+		from.for_each_prefix(collector{list, values_});
+		build(list);
+	}
+
+	size_t size() const { return values_.size(); }
+	bool empty() const { return values_.empty(); }
+
+	/**@return true if the address belongs any of the CIDRs
+	 * @param addr in host byte order (network for in6_addr_t)*/
+	bool check(const Key& addr, T& data) const
+	{
+		const node* y = &nodes_[0];
+		uint8_t offset = 0;
+		uint8_t v = traits::chunk(addr, offset, Stride);
+		while (y->vector & (1ULL << v))
+		{
+			y = &nodes_[y->base1 + popcount64(y->vector & ((2ULL << v) - 1)) - 1];
+			offset += Stride;
+			v = traits::chunk(addr, offset, Stride);
+		}
+		uint32_t value = leaves_[y->base0 + popcount64(y->leafvec & ((2ULL << v) - 1)) - 1];
+		if (value == 0)
+			return false;
+		data = values_[value - 1];
+		return true;
+	}
+
+	/**@brief approximate number of bytes used by the trie and data*/
+	size_t memory_footprint() const
+	{
+		return sizeof(*this) + nodes_.capacity()*sizeof(node)
+			+ leaves_.capacity()*sizeof(uint32_t) + values_.capacity()*sizeof(T);
+	}
+
+protected:
+	static const uint8_t FANOUT = 1 << Stride;
+
+	struct prefix
+	{
+		Key      key;
+		uint8_t  len;
+		uint32_t value; //!< index in values_ + 1
+	};
+
+	struct collector
+	{
+		template<class Cidr> void operator()(const Cidr& addr, const T& data)
+		{
+			uint8_t len = traits::len(addr);
+			list.push_back({traits::net(traits::key(addr), len), len,
+			                static_cast<uint32_t>(values.size() + 1)});
+			values.push_back(data);
+		}
+
+		std::vector<prefix>& list;
+		std::vector<T>&      values;
+	};
+
+	struct node
+	{
+		uint64_t vector;  //!< slots having child node
+		uint64_t leafvec; //!< slots where new leaf run starts
+		uint32_t base0;   //!< first leaf
+		uint32_t base1;   //!< first child
+	};
+
+	void build(std::vector<prefix> list);
+	node build(const prefix* first, const prefix* last, uint8_t offset, uint32_t def);
+
+	std::vector<node>     nodes_;
+	std::vector<uint32_t> leaves_;
+	std::vector<T>        values_;
+};
+
+template<class T, uint8_t Stride = 6> using basic_poptrie = multibit_trie<uint32_t, T, Stride>;
+template<class T, uint8_t Stride = 6> using basic_poptrie_v6 = multibit_trie<in6_addr_t, T, Stride>;
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class Key, class T, uint8_t Stride> void
+multibit_trie<Key, T, Stride>::build(std::vector<prefix> list)
+{
+	std::sort(list.begin(), list.end(), [](const prefix& lhv, const prefix& rhv)
+		{
+			return lhv.key < rhv.key || (lhv.key == rhv.key && lhv.len < rhv.len);
+		});
+	nodes_.clear();
+	leaves_.clear();
+	nodes_.resize(1);
+	uint32_t def = 0;
+	for (const prefix& p : list)
+		if (p.len == 0)
+			def = p.value;
+	node root = build(list.data(), list.data() + list.size(), 0, def);
+	nodes_[0] = root;
+}
+
+template<class Key, class T, uint8_t Stride> typename multibit_trie<Key, T, Stride>::node
+multibit_trie<Key, T, Stride>::build(const prefix* first, const prefix* last, uint8_t offset, uint32_t def)
+{
+	const uint8_t bottom = offset + Stride;
+
+	// leaf values: longest prefix ending inside this node covering the slot
+	uint32_t leaf[FANOUT];
+	uint8_t  leaf_len[FANOUT];
+	std::fill(leaf, leaf + FANOUT, def);
+	std::fill(leaf_len, leaf_len + FANOUT, 0);
+	// child ranges
+	const prefix* child_first[FANOUT];
+	const prefix* child_last[FANOUT];
+	std::fill(child_first, child_first + FANOUT, nullptr);
+
+	node rs{0, 0, 0, 0};
+	for (const prefix* p = first; p != last; ++p)
+	{
+		if (p->len <= offset)
+			continue;
+		uint8_t v = traits::chunk(p->key, offset, Stride);
+		if (p->len > bottom)
+		{
+			if (!child_first[v])
+				child_first[v] = p;
+			child_last[v] = p + 1;
+			rs.vector |= 1ULL << v;
+			continue;
+		}
+		uint8_t span = 1 << (bottom - p->len);
+		for (uint8_t i = v; i < v + span; ++i)
+		{
+			if (p->len >= leaf_len[i])
+			{
+				leaf[i] = p->value;
+				leaf_len[i] = p->len;
+			}
+		}
+	}
+
+	rs.base0 = static_cast<uint32_t>(leaves_.size());
+	bool first_leaf = true;
+	for (uint8_t i = 0; i < FANOUT; ++i)
+	{
+		if (rs.vector & (1ULL << i))
+			continue;
+		if (first_leaf || leaf[i] != leaves_.back())
+		{
+			rs.leafvec |= 1ULL << i;
+			leaves_.push_back(leaf[i]);
+		}
+		first_leaf = false;
+	}
+
+	rs.base1 = static_cast<uint32_t>(nodes_.size());
+	nodes_.resize(nodes_.size() + popcount64(rs.vector));
+	uint32_t child = rs.base1;
+	for (uint8_t i = 0; i < FANOUT; ++i)
+	{
+		if (!(rs.vector & (1ULL << i)))
+			continue;
+		node built = build(child_first[i], child_last[i], bottom, leaf[i]);
+		nodes_[child++] = built;
+	}
+	return rs;
+}
+
+} // namespace
@@ -0,0 +1,39 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 17:05:26 */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace iptools {
+
+/**@brief stable LSD radix sort
+ *
+ * Items are ordered by the key made of bytes byte(item, i), i = 0 is the
+ * least significant one. Passes where all the items fall into one bucket
+ * are skipped.
+ * @param bytes key length*/
+template<class Item, class Byte> void
+radix_sort(std::vector<Item>& items, size_t bytes, Byte byte)
+{
+	std::vector<Item> buf(items.size());
+	for (size_t b = 0; b < bytes; ++b)
+	{
+		size_t count[257] = {0};
+		for (const Item& i : items)
+			++count[byte(i, b) + 1];
+		bool single = false;
+		for (size_t k = 1; k < 257 && !single; ++k)
+			single = count[k] == items.size();
+		if (single)
+			continue;
+		for (size_t k = 1; k < 257; ++k)
+			count[k] += count[k - 1];
+		for (const Item& i : items)
+			buf[count[byte(i, b)]++] = i;
+		items.swap(buf);
+	}
+}
+
+} // namespace
@@ -0,0 +1,433 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 18:30:44 */
+
+#pragma once
+#include "cidr.hpp"
+#include <atomic>
+#include <type_traits>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace iptools {
+
+/**@brief LPFST living in the POSIX shared memory segment
+ *
+ * One process creates the segment and updates the table, any number of
+ * processes open it read-only and check addresses against the same copy.
+ * Nodes are kept in the fixed-capacity array right after the segment
+ * header and linked by indices, so every process can map the segment at
+ * its own address.
+ *
+ * Updates are published with the sequence lock: lookups never block the
+ * writer and are retried if an update was in progress.
+ *
+ * @warning readers spin while the writer is inside insert/remove/clear,
+ * if the writer dies there the segment should be recreated*/
+template<class T>
+class basic_shm_lpfst
+{
+	static_assert(std::is_trivially_copyable<T>::value, "shared data should be trivially copyable");
+
+public:
+	basic_shm_lpfst() {}
+	~basic_shm_lpfst() { close(); }
+
+	basic_shm_lpfst(const basic_shm_lpfst&) = delete;
+	basic_shm_lpfst& operator=(const basic_shm_lpfst&) = delete;
+
+	/**@brief create the new empty segment and map it for updates
+	 *
+	 * The segment with the same name is unlinked first, readers which have
+	 * it mapped keep the old copy until they reopen the name.
+	 * @param name shm_open name ("/something")
+	 * @param capacity maximal number of prefixes*/
+	bool create(const char* name, uint32_t capacity);
+
+	/**@brief map the existing segment read-only*/
+	bool open(const char* name);
+
+	void close();
+
+	static bool unlink(const char* name) { return ::shm_unlink(name) == 0; }
+
+	size_t size() const { return header_ ? header_->size.load(std::memory_order_relaxed) : 0; }
+	size_t capacity() const { return header_ ? header_->capacity : 0; }
+	bool empty() const { return size() == 0; }
+
+	/**@return false if the segment is full (and the prefix is not there to
+	 * be updated) or opened read-only*/
+	bool insert(iptools::cidr_v4 addr, T data);
+	void remove(const iptools::cidr_v4& addr);
+	void clear();
+
+	/**@return true if the address belongs any of the inserted CIDRs*/
+	bool check(const iptools::cidr_v4& addr, T& data) const;
+
+	/**@return true if the address belongs any of the inserted CIDRs
+	 * @param addr in host byte order*/
+	bool check(const uint32_t addr, T& data) const;
+
+protected:
+	static const uint32_t nil     = 0xFFFFFFFF;
+	static const uint32_t VERSION = 1;
+
+	struct header
+	{
+		char                  magic[8]; //!< "IPTSHMLP"
+		uint32_t              version;
+		uint32_t              value_size;
+		uint32_t              capacity;
+		std::atomic<uint32_t> seq;      //!< odd while the writer updates nodes
+		std::atomic<uint64_t> size;
+		uint32_t              root;
+		uint32_t              free;     //!< released nodes chained by left
+		uint32_t              used;     //!< nodes ever allocated
+	};
+
+	struct node
+	{
+		uint32_t prefix;
+		uint32_t left;
+		uint32_t right;
+		uint8_t  len;
+		T        data;
+	};
+
+	/**@brief sequence lock write section*/
+	class write_section
+	{
+	public:
+		explicit write_section(header& h) : h_(h)
+		{
+			h_.seq.store(h_.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		~write_section()
+		{
+			h_.seq.store(h_.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+	private:
+		header& h_;
+	};
+
+	static uint8_t len(const iptools::cidr_v4& addr) { return addr.is_net() ? addr.mask() : 32; }
+	static uint32_t mask(uint8_t len) { return len == 0 ? 0 : len >= 32 ? ~0U : ~0U << (32 - len); }
+	static size_t segment_size(uint32_t capacity) { return sizeof(header) + (size_t)capacity*sizeof(node); }
+
+	/**@return the link to the node of the prefix or nullptr*/
+	uint32_t* find_link(const iptools::cidr_v4& addr);
+
+	uint32_t new_node(const iptools::cidr_v4& addr, const T& data);
+	void free_node(uint32_t i);
+
+	/**@brief run the lookup until it is not overlapped by an update
+	 * @param find finds node index, nil or covered (no data)*/
+	template<class F> bool read(F find, T& data) const;
+
+	void*   map_{nullptr};
+	size_t  map_size_{0};
+	header* header_{nullptr};
+	node*   nodes_{nullptr};
+	bool    writable_{false};
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class T> bool
+basic_shm_lpfst<T>::create(const char* name, uint32_t capacity)
+{
+	close();
+	::shm_unlink(name);
+	int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		return false;
+	size_t sz = segment_size(capacity);
+	if (::ftruncate(fd, sz) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* map = ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	header* h = new (map) header;
+	h->version    = VERSION;
+	h->value_size = sizeof(T);
+	h->capacity   = capacity;
+	h->seq.store(0, std::memory_order_relaxed);
+	h->size.store(0, std::memory_order_relaxed);
+	h->root       = nil;
+	h->free       = nil;
+	h->used       = 0;
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(h->magic, "IPTSHMLP", sizeof(h->magic));
+	map_      = map;
+	map_size_ = sz;
+	header_   = h;
+	nodes_    = reinterpret_cast<node*>(static_cast<char*>(map) + sizeof(header));
+	writable_ = true;
+	return true;
+}
+
+template<class T> bool
+basic_shm_lpfst<T>::open(const char* name)
+{
+	close();
+	int fd = ::shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header))
+	{
+		::close(fd);
+		return false;
+	}
+	void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	header* h = static_cast<header*>(map);
+	if (memcmp(h->magic, "IPTSHMLP", sizeof(h->magic)) != 0 || h->version != VERSION
+	    || h->value_size != sizeof(T) || segment_size(h->capacity) != (size_t)st.st_size)
+	{
+		::munmap(map, st.st_size);
+		return false;
+	}
+	map_      = map;
+	map_size_ = st.st_size;
+	header_   = h;
+	nodes_    = reinterpret_cast<node*>(static_cast<char*>(map) + sizeof(header));
+	writable_ = false;
+	return true;
+}
+
+template<class T> void
+basic_shm_lpfst<T>::close()
+{
+	if (map_)
+		::munmap(map_, map_size_);
+	map_      = nullptr;
+	map_size_ = 0;
+	header_   = nullptr;
+	nodes_    = nullptr;
+	writable_ = false;
+}
+
+template<class T> bool
+basic_shm_lpfst<T>::insert(iptools::cidr_v4 addr, T data)
+{
+	if (!writable_)
+		return false;
+	if (header_->free == nil && header_->used == header_->capacity)
+	{
+		uint32_t* link = find_link(addr);
+		if (!link)
+			return false;
+		write_section section(*header_);
+		nodes_[*link].data = data;
+		return true;
+	}
+	write_section section(*header_);
+	if (header_->root == nil)
+	{
+		header_->root = new_node(addr, data);
+		return true;
+	}
+	uint32_t cur = header_->root;
+	for (uint8_t level = 0; ; ++level)
+	{
+		node& y = nodes_[cur];
+		if (len(addr) >= y.len)
+		{
+			iptools::cidr_v4 aux(y.prefix, y.len);
+			std::swap(y.data, data);
+			y.len = len(addr);
+			y.prefix = addr;
+			addr = aux;
+		}
+		if (len(addr) == y.len && ((uint32_t)addr & mask(y.len)) == (y.prefix & mask(y.len)))
+			return true;
+		if (len(addr) == level)
+			return true;
+		bool right = (((uint32_t)addr >> (31 - level)) & 1) != 0;
+		uint32_t next = right ? y.right : y.left;
+		if (next == nil)
+		{
+			next = new_node(addr, data);
+			if (right)
+				y.right = next;
+			else
+				y.left = next;
+			return true;
+		}
+		cur = next;
+	}
+}
+
+template<class T> void
+basic_shm_lpfst<T>::remove(const iptools::cidr_v4& toremove)
+{
+	if (!writable_)
+		return;
+	uint32_t* link = find_link(toremove);
+	if (!link)
+		return;
+	write_section section(*header_);
+	// push the node down to the leaf swapping with the longest child
+	for (;;)
+	{
+		node& y = nodes_[*link];
+		if (y.right == nil && y.left == nil)
+		{
+			free_node(*link);
+			*link = nil;
+			return;
+		}
+		uint32_t& child = (y.right == nil || (y.left != nil && nodes_[y.left].len > nodes_[y.right].len))
+			? y.left : y.right;
+		node& c = nodes_[child];
+		std::swap(y.len, c.len);
+		std::swap(y.prefix, c.prefix);
+		std::swap(y.data, c.data);
+		link = &child;
+	}
+}
+
+template<class T> void
+basic_shm_lpfst<T>::clear()
+{
+	if (!writable_)
+		return;
+	write_section section(*header_);
+	header_->root = nil;
+	header_->free = nil;
+	header_->used = 0;
+	header_->size.store(0, std::memory_order_relaxed);
+}
+
+template<class T> uint32_t*
+basic_shm_lpfst<T>::find_link(const iptools::cidr_v4& addr)
+{
+	uint32_t* link = &header_->root;
+	for (uint8_t level = 0; *link != nil; ++level)
+	{
+		const node& y = nodes_[*link];
+		if (y.len == len(addr) && y.prefix == ((uint32_t)addr & mask(y.len)))
+			break;
+		if (len(addr) == level)
+			return nullptr;
+		if ((((uint32_t)addr >> (31 - level)) & 1) == 0)
+			link = &nodes_[*link].left;
+		else
+			link = &nodes_[*link].right;
+	}
+	return *link == nil ? nullptr : link;
+}
+
+template<class T> uint32_t
+basic_shm_lpfst<T>::new_node(const iptools::cidr_v4& addr, const T& data)
+{
+	uint32_t rs = header_->free;
+	if (rs != nil)
+		header_->free = nodes_[rs].left;
+	else
+		rs = header_->used++;
+	node& y  = nodes_[rs];
+	y.len    = len(addr);
+	y.prefix = addr;
+	y.data   = data;
+	y.left   = nil;
+	y.right  = nil;
+	header_->size.fetch_add(1, std::memory_order_relaxed);
+	return rs;
+}
+
+template<class T> void
+basic_shm_lpfst<T>::free_node(uint32_t i)
+{
+	nodes_[i].left = header_->free;
+	header_->free = i;
+	header_->size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template<class T> template<class F> bool
+basic_shm_lpfst<T>::read(F find, T& data) const
+{
+	if (!header_)
+		return false;
+	for (;;)
+	{
+		uint32_t seq = header_->seq.load(std::memory_order_acquire);
+		if (seq & 1)
+			continue;
+		bool found = false;
+		T    tmp;
+		uint32_t i = find(found);
+		if (i != nil)
+			memcpy(&tmp, &nodes_[i].data, sizeof(T));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header_->seq.load(std::memory_order_relaxed) != seq)
+			continue;
+		if (i != nil)
+			data = tmp;
+		return found;
+	}
+}
+
+template<class T> bool
+basic_shm_lpfst<T>::check(const iptools::cidr_v4& addr, T& data) const
+{
+	bool     is_net = addr.is_net();
+	uint32_t addr_i = (uint32_t)addr;
+	uint8_t  mask_  = addr.mask();
+	// the links may be inconsistent during the update, so they are checked
+	return read([this, is_net, addr_i, mask_](bool& found)
+		{
+			uint32_t i = header_->root;
+			for (uint8_t level = 0; i < header_->capacity && level <= 32; ++level)
+			{
+				if (is_net && mask_ < level)
+				{
+					found = true;
+					return nil;
+				}
+				const node& y = nodes_[i];
+				if ((!is_net || mask_ >= y.len) && (addr_i & mask(y.len)) == y.prefix)
+				{
+					found = true;
+					return i;
+				}
+				i = (((uint64_t)addr_i << level >> 31) & 1) ? y.right : y.left;
+			}
+			return nil;
+		}, data);
+}
+
+template<class T> bool
+basic_shm_lpfst<T>::check(const uint32_t addr, T& data) const
+{
+	return read([this, addr](bool& found)
+		{
+			uint32_t i = header_->root;
+			for (uint8_t level = 0; i < header_->capacity && level <= 32; ++level)
+			{
+				const node& y = nodes_[i];
+				if ((addr & mask(y.len)) == y.prefix)
+				{
+					found = true;
+					return i;
+				}
+				i = (((uint64_t)addr << level >> 31) & 1) ? y.right : y.left;
+			}
+			return nil;
+		}, data);
+}
+
+} // namespace
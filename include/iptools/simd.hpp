@@ -0,0 +1,188 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 13:40:02 */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define IPTOOLS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace iptools {
+
+enum class simd_level
+{
+	scalar = 0,
+	sse2   = 1,
+	avx2   = 2,
+	avx512 = 3
+};
+
+/**@brief the best instruction set supported by the running CPU*/
+inline simd_level
+simd_detect()
+{
+#ifdef IPTOOLS_X86_SIMD
+	static const simd_level level = []()
+		{
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+				return simd_level::avx512;
+			if (__builtin_cpu_supports("avx2"))
+				return simd_level::avx2;
+			if (__builtin_cpu_supports("sse2"))
+				return simd_level::sse2;
+			return simd_level::scalar;
+		}();
+	return level;
+#else
+	return simd_level::scalar;
+#endif
+}
+
+/* DIR-24-8 two level lookup kernels. The first level entry with the
+ * highest bit set refers to the 256-entry block in the second level
+ * (entry & 0x7FFFFFFF is the block number), any other entry is the
+ * result. Second level should have less than 2^31 entries.*/
+
+inline void
+dir_24_8_lookup_scalar(const uint32_t* tbl24, const uint32_t* tbl8,
+                       const uint32_t* addrs, size_t n, uint32_t* entries)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint32_t e = tbl24[addrs[i] >> 8];
+		if (e & 0x80000000U)
+			e = tbl8[((e & 0x7FFFFFFFU) << 8) | (addrs[i] & 0xFF)];
+		entries[i] = e;
+	}
+}
+
+#ifdef IPTOOLS_X86_SIMD
+
+__attribute__((target("avx2"))) inline void
+dir_24_8_lookup_avx2(const uint32_t* tbl24, const uint32_t* tbl8,
+                     const uint32_t* addrs, size_t n, uint32_t* entries)
+{
+	const __m256i low = _mm256_set1_epi32(0xFF);
+	const __m256i blk = _mm256_set1_epi32(0x7FFFFFFF);
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(addrs + i));
+		__m256i e = _mm256_i32gather_epi32(reinterpret_cast<const int*>(tbl24),
+		                                   _mm256_srli_epi32(a, 8), 4);
+		__m256i ext = _mm256_srai_epi32(e, 31);
+		if (!_mm256_testz_si256(ext, ext))
+		{
+			__m256i idx = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(e, blk), 8),
+			                              _mm256_and_si256(a, low));
+			e = _mm256_mask_i32gather_epi32(e, reinterpret_cast<const int*>(tbl8), idx, ext, 4);
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(entries + i), e);
+	}
+	dir_24_8_lookup_scalar(tbl24, tbl8, addrs + i, n - i, entries + i);
+}
+
+__attribute__((target("avx512f"))) inline void
+dir_24_8_lookup_avx512(const uint32_t* tbl24, const uint32_t* tbl8,
+                       const uint32_t* addrs, size_t n, uint32_t* entries)
+{
+	const __m512i low = _mm512_set1_epi32(0xFF);
+	const __m512i blk = _mm512_set1_epi32(0x7FFFFFFF);
+	const __m512i top = _mm512_set1_epi32(0x80000000);
+	const __m512i zero = _mm512_setzero_si512();
+	const __mmask16 all = 0xFFFF;
+	size_t i = 0;
+	// masked forms with the zero source, the unmasked ones expand over the
+	// undefined vector and GCC warns about maybe uninitialized use
+	for (; i + 16 <= n; i += 16)
+	{
+		__m512i a = _mm512_loadu_si512(addrs + i);
+		__m512i e = _mm512_mask_i32gather_epi32(zero, all, _mm512_maskz_srli_epi32(all, a, 8), tbl24, 4);
+		__mmask16 ext = _mm512_test_epi32_mask(e, top);
+		if (ext)
+		{
+			__m512i idx = _mm512_or_si512(_mm512_maskz_slli_epi32(all, _mm512_and_si512(e, blk), 8),
+			                              _mm512_and_si512(a, low));
+			e = _mm512_mask_i32gather_epi32(e, ext, idx, tbl8, 4);
+		}
+		_mm512_storeu_si512(entries + i, e);
+	}
+	dir_24_8_lookup_scalar(tbl24, tbl8, addrs + i, n - i, entries + i);
+}
+
+#endif // IPTOOLS_X86_SIMD
+
+/**@brief resolve n addresses (host byte order) into DIR-24-8 entries
+ * @param level the kernel to use, falls back to the best supported one*/
+inline void
+dir_24_8_lookup(const uint32_t* tbl24, const uint32_t* tbl8,
+                const uint32_t* addrs, size_t n, uint32_t* entries,
+                simd_level level = simd_detect())
+{
+	if (level > simd_detect())
+		level = simd_detect();
+	switch (level)
+	{
+#ifdef IPTOOLS_X86_SIMD
+		case simd_level::avx512:
+			dir_24_8_lookup_avx512(tbl24, tbl8, addrs, n, entries);
+			return;
+		case simd_level::avx2:
+			dir_24_8_lookup_avx2(tbl24, tbl8, addrs, n, entries);
+			return;
+#endif
+		default:
+			dir_24_8_lookup_scalar(tbl24, tbl8, addrs, n, entries);
+	}
+}
+
+/* Separator scanning kernels: 64 bytes starting from p are compared with
+ * two separators, bit i of the result is set if p[i] is one of them.*/
+
+inline uint64_t
+scan_separators_scalar(const char* p, char a, char b)
+{
+	uint64_t rs = 0;
+	for (unsigned i = 0; i < 64; ++i)
+		if (p[i] == a || p[i] == b)
+			rs |= 1ULL << i;
+	return rs;
+}
+
+#ifdef IPTOOLS_X86_SIMD
+
+__attribute__((target("sse2"))) inline uint64_t
+scan_separators_sse2(const char* p, char a, char b)
+{
+	const __m128i va = _mm_set1_epi8(a);
+	const __m128i vb = _mm_set1_epi8(b);
+	uint64_t rs = 0;
+	for (unsigned i = 0; i < 64; i += 16)
+	{
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb));
+		rs |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << i;
+	}
+	return rs;
+}
+
+__attribute__((target("avx2"))) inline uint64_t
+scan_separators_avx2(const char* p, char a, char b)
+{
+	const __m256i va = _mm256_set1_epi8(a);
+	const __m256i vb = _mm256_set1_epi8(b);
+	__m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	__m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+	uint32_t mlo = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, va), _mm256_cmpeq_epi8(lo, vb)));
+	uint32_t mhi = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, va), _mm256_cmpeq_epi8(hi, vb)));
+	return ((uint64_t)mhi << 32) | mlo;
+}
+
+#endif // IPTOOLS_X86_SIMD
+
+} // namespace
@@ -0,0 +1,180 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 16:34:52 */
+
+#pragma once
+#include "epoch.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace iptools {
+
+/**@brief Shared immutable lookup table replaced as a whole
+ *
+ * Readers always see some complete version of the Engine (basic_lpfst,
+ * its snapshot, basic_dir_24_8, basic_poptrie...). A new version is built
+ * aside, possibly in the background thread, and published with a single
+ * atomic pointer store, so lookups are never blocked by a reload. The old
+ * version is destroyed as soon as the readers started before the swap
+ * leave it.
+ *
+ * The on_swap callback runs after the publisher lock is released, so it
+ * may publish or rebuild itself. The table it gets stays alive until the
+ * callback returns, even if it is replaced meanwhile.
+ *
+ * Every lookup thread gets its own reader (make_reader()).*/
+template<class Engine>
+class table_handle
+{
+public:
+	class reader;
+
+	/**@brief called after every swap with the new table and its version*/
+	using swap_callback = std::function<void(const Engine&, uint64_t)>;
+
+	/**@param max_readers the number of readers alive at the same time*/
+	explicit table_handle(size_t max_readers = 128)
+		: table_handle(Engine(), max_readers)
+	{}
+
+	explicit table_handle(Engine table, size_t max_readers = 128)
+		: owner_(std::make_shared<Engine>(std::move(table)))
+		, current_(owner_.get())
+		, domain_(max_readers)
+	{}
+
+	~table_handle() { wait(); }
+
+	table_handle(const table_handle&) = delete;
+	table_handle& operator=(const table_handle&) = delete;
+
+	/**@brief register lookup thread, waits if there are max_readers alive*/
+	reader make_reader() const { return reader(this, domain_.make_reader()); }
+
+	/**@brief number of swaps done*/
+	uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+	/**@brief set the function called after every swap (in the swapping thread)*/
+	void on_swap(swap_callback callback)
+	{
+		std::lock_guard<std::mutex> lock(writer_);
+		callback_ = std::move(callback);
+	}
+
+	/**@brief replace the table, returns after the readers left the old one
+	 * (it is destroyed then, unless an on_swap callback still holds it)*/
+	void publish(Engine table);
+
+	/**@brief build a new table with build() in the background and publish it
+	 *
+	 * The previous background rebuild (if any) is finished first. Called
+	 * from on_swap in the background thread, it is queued after the
+	 * current one.
+	 * @param build functor returning Engine*/
+	template<class F> void rebuild(F build)
+	{
+		if (builder_.get_id() == std::this_thread::get_id())
+		{
+			chained_ = build;
+			return;
+		}
+		wait();
+		builder_ = std::thread([this, build]()
+			{
+				publish(build());
+				while (chained_)
+				{
+					std::function<Engine()> next;
+					next.swap(chained_);
+					publish(next());
+				}
+			});
+	}
+
+	/**@brief wait for the background rebuild to finish*/
+	void wait()
+	{
+		if (builder_.joinable())
+			builder_.join();
+	}
+
+private:
+	using owner_t = std::shared_ptr<const Engine>;
+
+	owner_t                    owner_; //!< of the current table, under writer_
+	std::atomic<const Engine*> current_;
+	std::atomic<uint64_t>      version_{0};
+	mutable epoch_domain       domain_;
+	std::mutex                 writer_; //!< publishers, epoch_domain has one writer
+	swap_callback              callback_;
+	std::thread                builder_;
+	std::function<Engine()>    chained_; //!< rebuild requested by on_swap in builder_
+};
+
+/**@brief Lookup side of the table_handle, one per thread*/
+template<class Engine>
+class table_handle<Engine>::reader
+{
+public:
+	reader() {}
+
+	/**@brief Engine::check on the current table*/
+	template<class... Args> bool check(Args&&... args)
+	{
+		epoch_domain::guard guard(reader_);
+		return handle_->current_.load(std::memory_order_acquire)->check(std::forward<Args>(args)...);
+	}
+
+	/**@brief call fun(const Engine&) with the current table
+	 * @warning the table reference must not be kept after fun returns*/
+	template<class F> auto read(F&& fun) -> decltype(fun(std::declval<const Engine&>()))
+	{
+		epoch_domain::guard guard(reader_);
+		return fun(*handle_->current_.load(std::memory_order_acquire));
+	}
+
+private:
+	reader(const table_handle* handle, epoch_domain::reader&& r)
+		: handle_(handle)
+		, reader_(std::move(r))
+	{}
+
+	const table_handle*  handle_{nullptr};
+	epoch_domain::reader reader_;
+
+friend class table_handle;
+};
+
+////////////////////////////////////////////////////////////////////////
+// inline
+
+template<class Engine> void
+table_handle<Engine>::publish(Engine table)
+{
+	owner_t       next = std::make_shared<const Engine>(std::move(table));
+	owner_t*      prev = new owner_t(next);
+	swap_callback callback;
+	uint64_t      version;
+	{
+		std::lock_guard<std::mutex> lock(writer_);
+		prev->swap(owner_);
+		current_.store(next.get(), std::memory_order_release);
+		version = version_.fetch_add(1, std::memory_order_acq_rel) + 1;
+		// readers may still use the previous table, its reference is
+		// dropped when they leave it
+		domain_.retire(prev);
+		domain_.synchronize();
+		while (domain_.pending() > 0)
+		{
+			std::this_thread::yield();
+			domain_.synchronize();
+		}
+		callback = callback_;
+	}
+	if (callback)
+		callback(*next, version);
+}
+
+} // namespace
@@ -11,6 +11,18 @@
 #include "test_cidr_v6.hpp"
 #include "test_lpfst.hpp"
 #include "test_lpfst_v6.hpp"
+#include "test_dir_24_8.hpp"
+#include "test_poptrie.hpp"
+#include "test_concurrent_lpfst.hpp"
+#include "test_table_handle.hpp"
+#include "test_lpfst_image.hpp"
+#include "test_shm_lpfst.hpp"
+#include "test_loader.hpp"
+#include "test_bulk_parser.hpp"
+#include "test_generator.hpp"
+#include "test_instrumentation.hpp"
+#include "test_flow_cache.hpp"
+#include "test_hybrid_lpfst.hpp"
 
 int main(int argc, char *argv[])
 {
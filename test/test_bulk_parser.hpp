@@ -0,0 +1,113 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 20:10:37*/
+
+#include <iptools/bulk_parser.hpp>
+#include <iptools/bulk_formatter.hpp>
+#include <random>
+
+using namespace iptools;
+
+TEST(test_bulk_parser, simple_v4)
+{
+	const std::string text = "10.0.0.1,192.168.0.0/16,,bad\r\n8.8.8.8/33\n\n1.2.3.4";
+	for (auto level : {simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512})
+	{
+		uint32_t addrs[8];
+		uint8_t  masks[8];
+		size_t   consumed = 0;
+		ASSERT_EQ(5, parse_fields(text.data(), text.size(), ',', addrs, masks, 8, &consumed, level));
+		EXPECT_EQ(text.size(), consumed);
+		EXPECT_EQ(0x0A000001U, addrs[0]);
+		EXPECT_EQ(32,          masks[0]);
+		EXPECT_EQ(0xC0A80000U, addrs[1]);
+		EXPECT_EQ(16,          masks[1]);
+		EXPECT_EQ(invalid_field, masks[2]);
+		EXPECT_EQ(invalid_field, masks[3]);
+		EXPECT_EQ(0x01020304U, addrs[4]);
+		EXPECT_EQ(32,          masks[4]);
+
+		ASSERT_EQ(2, parse_fields(text.data(), text.size(), ',', addrs, masks, 2, &consumed, level));
+		EXPECT_EQ(text.find(",,") + 1, consumed);
+	}
+}
+
+TEST(test_bulk_parser, simple_v6)
+{
+	const std::string text = "2001:db8::/32\t::ffff:1.2.3.4\tfe80::1\n";
+	in6_addr_t addrs[4];
+	uint8_t    masks[4];
+	ASSERT_EQ(3, parse_fields(text.data(), text.size(), '\t', addrs, masks, 4));
+	EXPECT_EQ(cidr_v6("2001:db8::/32"), cidr_v6(addrs[0], masks[0]));
+	EXPECT_EQ(cidr_v6("::ffff:1.2.3.4"), cidr_v6(addrs[1], masks[1]));
+	EXPECT_EQ(128, masks[2]);
+}
+
+TEST(test_bulk_parser, same_as_scalar)
+{
+	std::mt19937 rng(7);
+	std::string text;
+	std::vector<uint32_t> expected;
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		uint32_t addr = rng();
+		text += cidr_v4(addr, 32).str(true);
+		expected.push_back(addr);
+		text += (rng() % 4 == 0) ? "\n" : " ";
+	}
+	text += "1.2.3.4";
+	expected.push_back(0x01020304);
+
+	for (auto level : {simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512})
+	{
+		std::vector<uint32_t> addrs(expected.size() + 1);
+		std::vector<uint8_t>  masks(expected.size() + 1);
+		// every tail length
+		for (size_t cut = 0; cut < 70; ++cut)
+		{
+			size_t len = text.size() - cut;
+			size_t n = parse_fields(text.data(), len, ' ', addrs.data(), masks.data(), addrs.size(), nullptr, level);
+			ASSERT_LE(n, expected.size());
+			ASSERT_GE(n + 10, expected.size()) << "level " << (int)level;
+			for (size_t i = 0; i + 1 < n; ++i)
+				ASSERT_EQ(expected[i], addrs[i]) << i << " level " << (int)level;
+		}
+		size_t n = parse_fields(text.data(), text.size(), ' ', addrs.data(), masks.data(), addrs.size(), nullptr, level);
+		ASSERT_EQ(expected.size(), n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			ASSERT_EQ(expected[i], addrs[i]) << i;
+			ASSERT_EQ(32, masks[i]);
+		}
+	}
+}
+
+TEST(test_bulk_parser, format_fields)
+{
+	std::mt19937 rng(11);
+	std::vector<uint32_t> addrs;
+	std::vector<uint8_t>  masks;
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		addrs.push_back(rng());
+		masks.push_back(rng() % 33);
+	}
+	std::vector<char> buf(addrs.size()*(cidr_v4::max_str_len + 1));
+	size_t written = 0;
+	ASSERT_EQ(addrs.size(), format_fields(addrs.data(), masks.data(), addrs.size(), ',', buf.data(), buf.size(), &written));
+	std::vector<uint32_t> parsed(addrs.size());
+	std::vector<uint8_t>  parsed_masks(addrs.size());
+	ASSERT_EQ(addrs.size(), parse_fields(buf.data(), written, ',', parsed.data(), parsed_masks.data(), parsed.size()));
+	EXPECT_EQ(addrs, parsed);
+	EXPECT_EQ(masks, parsed_masks);
+
+	// the buffer is filled by whole fields only
+	const uint32_t two[] = {0x01020304, 0x0A000001};
+	char small[16];
+	ASSERT_EQ(1, format_fields(two, nullptr, 2, '\n', small, sizeof(small), &written));
+	EXPECT_EQ("1.2.3.4\n", std::string(small, written));
+
+	in6_addr_t v6[] = {cidr_v6("2001:db8::1"), cidr_v6("::ffff:10.0.0.1")};
+	char text[2*(cidr_v6::max_str_len + 1)];
+	ASSERT_EQ(2, format_fields(v6, nullptr, 2, ' ', text, sizeof(text), &written));
+	EXPECT_EQ("2001:db8::1 ::ffff:10.0.0.1 ", std::string(text, written));
+}
@@ -195,3 +195,66 @@ TEST(test_cidr_v4, distance_whole)
 	                                       cidr_v4("0.0.0.0/0").end()));
 }
 
+
+TEST(test_cidr_v4, parse)
+{
+	const char* good[] = {"0.0.0.0", "1.2.3.4", "255.255.255.255", "10.0.0.0/8",
+	                      "192.168.1.1/32", "0.0.0.0/0", "127.0.0.1/24"};
+	for (const char* str : good)
+	{
+		cidr_v4 addr(1, 1);
+		ASSERT_EQ(parse_error::ok, cidr_v4::parse(str, strlen(str), addr)) << str;
+		EXPECT_EQ(cidr_v4(str), addr) << str;
+	}
+
+	struct { const char* str; parse_error err; } bad[] = {
+		{"",                  parse_error::empty      },
+		{"1.2.3",             parse_error::bad_address},
+		{"1.2.3.4.5",         parse_error::bad_address},
+		{"1.2.3.256",         parse_error::bad_address},
+		{"1.2.3.04",          parse_error::bad_address},
+		{"1..3.4",            parse_error::bad_address},
+		{"1.2.3.4 ",          parse_error::bad_address},
+		{"a.2.3.4",           parse_error::bad_address},
+		{"1.2.3.4/",          parse_error::bad_mask   },
+		{"1.2.3.4/33",        parse_error::bad_mask   },
+		{"1.2.3.4/123",       parse_error::bad_mask   },
+		{"1.2.3.4/2x",        parse_error::bad_mask   }};
+	for (const auto& b : bad)
+	{
+		cidr_v4 addr(1, 1);
+		EXPECT_EQ(b.err, cidr_v4::parse(b.str, strlen(b.str), addr)) << b.str;
+		EXPECT_EQ(cidr_v4(1, 1), addr);
+	}
+	// the range, not the C string
+	cidr_v4 addr;
+	ASSERT_EQ(parse_error::ok, cidr_v4::parse("10.1.2.3/16 tail", 11, addr));
+	EXPECT_EQ(cidr_v4("10.1.2.3/16"), addr);
+}
+
+#if __cplusplus >= 201402L
+static constexpr uint32_t
+test_cidr_v4_constexpr_parse()
+{
+	cidr_v4 addr(0, 0);
+	cidr_v4::parse("10.1.2.3/8", 10, addr);
+	return addr.mask();
+}
+static_assert(test_cidr_v4_constexpr_parse() == 8, "constexpr parse");
+#endif
+
+TEST(test_cidr_v4, to_chars)
+{
+	char buf[cidr_v4::max_str_len];
+	cidr_v4 addr("255.255.255.255/32");
+	char* end = addr.to_chars(buf, buf + sizeof(buf));
+	ASSERT_NE(nullptr, end);
+	EXPECT_EQ("255.255.255.255/32", std::string(buf, end));
+	EXPECT_EQ(nullptr, addr.to_chars(buf, buf + sizeof(buf) - 1));
+	end = cidr_v4("10.0.20.3/8").to_chars(buf, buf + 9, true);
+	ASSERT_NE(nullptr, end);
+	EXPECT_EQ("10.0.20.3", std::string(buf, end));
+	EXPECT_EQ(nullptr, cidr_v4("10.0.20.3/8").to_chars(buf, buf + 10));
+	EXPECT_EQ("0.0.0.0/0", cidr_v4(0, 0).str());
+	EXPECT_EQ("1.2.3.4", cidr_v4(0x01020304, 32).str(true));
+}
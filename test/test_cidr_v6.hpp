@@ -3,6 +3,8 @@
 
 #include <iptools/cidr_v6.hpp>
 #include <sstream>
+#include <random>
+#include <vector>
 
 using namespace iptools;
 
@@ -129,3 +131,82 @@ TEST(test_cidr_v6, print_binary)
 	EXPECT_EQ("[00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000001]", cidr_v6("::1").bstr());
 	EXPECT_EQ("[]00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000000'00000001", cidr_v6("::1/0").bstr());
 }
+
+TEST(test_cidr_v6, parse)
+{
+	const char* good[] = {"::", "::1", "1::", "2001:db8::1", "2001:DB8:0:0:8:800:200C:417A",
+	                      "fe80::1:2:3:4:5", "1:2:3:4:5:6:7::", "::1:2:3:4:5:6:7",
+	                      "::ffff:192.168.1.1", "64:ff9b::10.0.0.1", "1:2:3:4:5:6:1.2.3.4"};
+	for (const char* str : good)
+	{
+		std::array<uint8_t, 16> expected;
+		ASSERT_EQ(1, inet_pton(AF_INET6, str, expected.data())) << str;
+		cidr_v6 addr;
+		ASSERT_EQ(parse_error::ok, cidr_v6::parse(str, strlen(str), addr)) << str;
+		EXPECT_EQ(cidr_v6(expected, 128), addr) << str;
+	}
+	cidr_v6 addr;
+	ASSERT_EQ(parse_error::ok, cidr_v6::parse("2001:db8::/32", 13, addr));
+	EXPECT_EQ(cidr_v6("2001:db8::/32"), addr);
+
+	struct { const char* str; parse_error err; } bad[] = {
+		{"",                      parse_error::empty      },
+		{":",                     parse_error::bad_address},
+		{":::",                   parse_error::bad_address},
+		{"1:2",                   parse_error::bad_address},
+		{"1::2::3",               parse_error::bad_address},
+		{"12345::",               parse_error::bad_address},
+		{"1:2:3:4:5:6:7:8:9",     parse_error::bad_address},
+		{"1:2:3:4:5:6:7:8::",     parse_error::bad_address},
+		{"1:",                    parse_error::bad_address},
+		{"g::",                   parse_error::bad_address},
+		{"::1.2.3",               parse_error::bad_address},
+		{"1:2:3:4:5:6:7:1.2.3.4", parse_error::bad_address},
+		{"::1/",                  parse_error::bad_mask   },
+		{"::1/129",               parse_error::bad_mask   },
+		{"::1/1x",                parse_error::bad_mask   }};
+	for (const auto& b : bad)
+	{
+		cidr_v6 addr;
+		EXPECT_EQ(b.err, cidr_v6::parse(b.str, strlen(b.str), addr)) << b.str;
+		std::array<uint8_t, 16> tmp;
+		if (b.err == parse_error::bad_address)
+			EXPECT_NE(1, inet_pton(AF_INET6, b.str, tmp.data())) << b.str;
+	}
+}
+
+TEST(test_cidr_v6, to_chars)
+{
+	// the same text as inet_ntop, including zero runs and the dotted quad
+	std::vector<std::array<uint8_t, 16> > addrs = {
+		mkaddr(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+		mkaddr(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1),
+		mkaddr(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4),
+		mkaddr(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 1, 2, 3, 4),
+		mkaddr(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0, 0, 0, 0),
+		mkaddr(0x20, 0x01, 0x0D, 0xB8, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1),
+		mkaddr(0x20, 0x01, 0x0D, 0xB8, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1),
+		mkaddr(0xFE, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0),
+		mkaddr(0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF)};
+	std::mt19937 rng(3);
+	for (size_t i = 0; i < 2000; ++i)
+	{
+		std::array<uint8_t, 16> addr;
+		for (auto& b : addr)
+			b = (rng() % 3 == 0) ? rng() : 0;
+		addrs.push_back(addr);
+	}
+	char buf[cidr_v6::max_str_len];
+	for (const auto& addr : addrs)
+	{
+		char expected[INET6_ADDRSTRLEN];
+		ASSERT_NE(nullptr, inet_ntop(AF_INET6, addr.data(), expected, sizeof(expected)));
+		EXPECT_EQ(std::string(expected) + "/128", cidr_v6(addr, 128).str());
+		char* end = cidr_v6(addr, 7).to_chars(buf, buf + sizeof(buf), true);
+		ASSERT_NE(nullptr, end);
+		EXPECT_EQ(expected, std::string(buf, end));
+	}
+	cidr_v6 full(addrs[8], 128);
+	EXPECT_EQ((size_t)cidr_v6::max_str_len , (size_t)(full.to_chars(buf, buf + sizeof(buf)) - buf));
+	EXPECT_EQ(nullptr, full.to_chars(buf, buf + sizeof(buf) - 1));
+}
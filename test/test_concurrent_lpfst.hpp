@@ -0,0 +1,132 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 15:41:37*/
+
+#include <iptools/concurrent_lpfst.hpp>
+#include <iptools/lpfst.hpp>
+#include <random>
+#include <set>
+#include <thread>
+
+using namespace iptools;
+
+TEST(test_concurrent_lpfst, simple_check)
+{
+	basic_concurrent_lpfst<int> ipset;
+	ipset.insert({"10.0.0.0/8"    }, 1);
+	ipset.insert({"192.168.3.0/24"}, 2);
+	ipset.insert({"10.0.2.0/24"   }, 3);
+	ipset.insert({"213.1.2.0/24"  }, 4);
+	EXPECT_EQ(4, ipset.size());
+
+	auto reader = ipset.make_reader();
+	int data = 0;
+	EXPECT_TRUE (reader.check(ntohl(inet_addr("10.0.2.1")), data));
+	EXPECT_EQ(3, data);
+	EXPECT_TRUE (reader.check(ntohl(inet_addr("10.1.2.1")), data));
+	EXPECT_EQ(1, data);
+	EXPECT_TRUE (reader.check({"213.1.2.255/24"}, data));
+	EXPECT_EQ(4, data);
+	EXPECT_FALSE(reader.check({"10.0.0.0/7"}, data));
+	EXPECT_FALSE(reader.check(ntohl(inet_addr("192.168.4.1")), data));
+
+	ipset.insert({"213.1.2.0/24"}, 5);
+	EXPECT_EQ(4, ipset.size());
+	EXPECT_TRUE (reader.check(ntohl(inet_addr("213.1.2.1")), data));
+	EXPECT_EQ(5, data);
+
+	ipset.remove({"10.0.0.0/8"});
+	ipset.remove({"11.0.0.0/8"});
+	EXPECT_EQ(3, ipset.size());
+	EXPECT_FALSE(reader.check(ntohl(inet_addr("10.1.2.1")), data));
+	EXPECT_TRUE (reader.check(ntohl(inet_addr("10.0.2.1")), data));
+
+	ipset.clear();
+	EXPECT_TRUE(ipset.empty());
+	EXPECT_FALSE(reader.check(ntohl(inet_addr("10.0.2.1")), data));
+}
+
+TEST(test_concurrent_lpfst, same_as_lpfst)
+{
+	std::mt19937 rng(20261018);
+	basic_lpfst<uint32_t> expected;
+	basic_concurrent_lpfst<uint32_t> ipset;
+	std::set<uint32_t> used;
+	std::vector<cidr_v4> inserted;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t  len = 8 + rng()%25;
+		uint32_t prefix = rng() >> (32 - len) << (32 - len);
+		if (!used.insert(prefix).second)
+			continue;
+		inserted.push_back(cidr_v4(prefix, len));
+		expected.insert(inserted.back(), i);
+		ipset.insert(inserted.back(), i);
+	}
+	for (size_t i = 0; i < inserted.size(); i += 3)
+	{
+		expected.remove(inserted[i]);
+		ipset.remove(inserted[i]);
+	}
+
+	auto reader = ipset.make_reader();
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t data = 0, rs = 0;
+		bool found = expected.check(addr, data);
+		ASSERT_EQ(found, reader.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(data, rs);
+		cidr_v4 net(addr >> 12 << 12, 20);
+		ASSERT_EQ(expected.check(net, data), reader.check(net, rs)) << net;
+	}
+	size_t count = 0;
+	ipset.for_each_prefix([&count](const cidr_v4&, uint32_t) { ++count; });
+	EXPECT_EQ(count, ipset.size());
+}
+
+TEST(test_concurrent_lpfst, readers_while_writing)
+{
+	basic_concurrent_lpfst<uint32_t> ipset;
+	std::vector<cidr_v4> stable, volatile_;
+	std::mt19937 rng(20261019);
+	for (uint32_t i = 0; i < 256; i += 2)
+	{
+		stable.push_back(cidr_v4((10U << 24) | (i << 16), 16));
+		volatile_.push_back(cidr_v4((10U << 24) | ((i + 1) << 16) | (rng() & 0xFF00), 24));
+		ipset.insert(stable.back(), i);
+	}
+
+	std::atomic<bool> stop{false};
+	std::atomic<size_t> errors{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t)
+	{
+		readers.emplace_back([&ipset, &stop, &errors, t]()
+			{
+				auto reader = ipset.make_reader();
+				std::mt19937 rng(t);
+				while (!stop.load())
+				{
+					uint32_t i = rng() & 0xFE;
+					uint32_t addr = (10U << 24) | (i << 16) | (rng() & 0xFFFF);
+					uint32_t data = 0;
+					// stable prefixes are always visible
+					if (!reader.check(addr, data) || data != i)
+						++errors;
+				}
+			});
+	}
+	for (int round = 0; round < 20; ++round)
+	{
+		for (uint32_t i = 0; i < volatile_.size(); ++i)
+			ipset.insert(volatile_[i], 1000);
+		for (uint32_t i = 0; i < volatile_.size(); ++i)
+			ipset.remove(volatile_[i]);
+	}
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+	EXPECT_EQ(0, errors.load());
+	EXPECT_EQ(stable.size(), ipset.size());
+}
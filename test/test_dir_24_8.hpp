@@ -0,0 +1,161 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 10:12:40*/
+
+#include <iptools/dir_24_8.hpp>
+#include <random>
+#include <set>
+
+using namespace iptools;
+
+TEST(test_dir_24_8, simple_check_uint32)
+{
+	basic_lpfst<std::string> ipset;
+	ipset.insert({"10.0.0.0/8"     }, "a");
+	ipset.insert({"10.0.2.0/24"    }, "b");
+	ipset.insert({"10.0.2.128/25"  }, "c");
+	ipset.insert({"192.168.3.0/24" }, "d");
+	ipset.insert({"192.168.3.17/32"}, "e");
+
+	basic_dir_24_8<std::string> dir(ipset);
+	EXPECT_EQ(5, dir.size());
+
+	std::string rs;
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.1.2.3"     )), rs));
+	EXPECT_EQ   ("a", rs);
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.3"     )), rs));
+	EXPECT_EQ   ("b", rs);
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.129"   )), rs));
+	EXPECT_EQ   ("c", rs);
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("192.168.3.16" )), rs));
+	EXPECT_EQ   ("d", rs);
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("192.168.3.17" )), rs));
+	EXPECT_EQ   ("e", rs);
+	EXPECT_FALSE(dir.check(ntohl(inet_addr("11.0.0.1"     )), rs));
+	EXPECT_FALSE(dir.check(ntohl(inet_addr("192.168.4.1"  )), rs));
+}
+
+TEST(test_dir_24_8, insert_remove)
+{
+	basic_dir_24_8<std::string> dir;
+	std::string rs;
+	EXPECT_FALSE(dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	size_t empty_footprint = dir.memory_footprint();
+
+	dir.insert({"10.0.2.128/25"}, "c");
+	dir.insert({"10.0.2.0/24"  }, "b");
+	dir.insert({"10.0.0.0/8"   }, "a");
+	EXPECT_GT(dir.memory_footprint(), empty_footprint);
+
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	EXPECT_EQ   ("c", rs);
+	dir.remove({"10.0.2.128/25"});
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	EXPECT_EQ   ("b", rs);
+	dir.remove({"10.0.2.0/24"});
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	EXPECT_EQ   ("a", rs);
+	dir.remove({"10.0.2.0/24"});
+	EXPECT_EQ(1, dir.size());
+	dir.remove({"10.0.0.0/8"});
+	EXPECT_FALSE(dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	EXPECT_TRUE(dir.empty());
+
+	dir.insert({"10.0.0.0/8"}, "a");
+	dir.insert({"10.0.0.0/8"}, "z");
+	EXPECT_EQ(1, dir.size());
+	EXPECT_TRUE (dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+	EXPECT_EQ   ("z", rs);
+	dir.clear();
+	EXPECT_FALSE(dir.check(ntohl(inet_addr("10.0.2.129")), rs));
+}
+
+TEST(test_dir_24_8, same_as_lpfst)
+{
+	std::mt19937 rng(20261018);
+	basic_lpfst<uint32_t> ipset;
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		ipset.insert(cidr_v4(rng() >> (32 - len) << (32 - len), len), i);
+	}
+
+	basic_dir_24_8<uint32_t> dir(ipset);
+	EXPECT_EQ(ipset.size(), dir.size());
+	for (size_t i = 0; i < 200000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t expected = 0, rs = 0;
+		bool found = ipset.check(addr, expected);
+		ASSERT_EQ(found, dir.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, rs);
+	}
+}
+
+TEST(test_dir_24_8, patch_same_as_rebuild)
+{
+	std::mt19937 rng(20261019);
+	std::vector<std::pair<cidr_v4, uint32_t> > prefixes;
+	std::set<std::pair<uint32_t, uint8_t> > seen;
+	basic_dir_24_8<uint32_t> dir;
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		cidr_v4 addr(rng() >> (32 - len) << (32 - len), len);
+		if (!seen.insert({(uint32_t)addr, len}).second)
+			continue;
+		dir.insert(addr, i);
+		prefixes.push_back({addr, i});
+	}
+	basic_dir_24_8<uint32_t> rebuilt;
+	for (size_t i = 0; i < prefixes.size(); ++i)
+	{
+		if (i%2 == 0)
+			dir.remove(prefixes[i].first);
+		else
+			rebuilt.insert(prefixes[i].first, prefixes[i].second);
+	}
+	EXPECT_EQ(rebuilt.size(), dir.size());
+
+	for (size_t i = 0; i < 200000; ++i)
+	{
+		uint32_t addr = i%2 == 0 ? rng()
+		              : (uint32_t)prefixes[rng()%prefixes.size()].first | (rng() & 0x3FF);
+		uint32_t expected = 0, rs = 0;
+		bool found = rebuilt.check(addr, expected);
+		ASSERT_EQ(found, dir.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, rs);
+	}
+}
+
+TEST(test_dir_24_8, check_batch_simd)
+{
+	std::mt19937 rng(20261021);
+	basic_dir_24_8<uint32_t> dir;
+	std::vector<uint32_t> addrs;
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		uint32_t addr = rng();
+		dir.insert(cidr_v4(addr >> (32 - len) << (32 - len), len), i);
+		addrs.push_back(addr ^ (rng() & 0xFF));
+		addrs.push_back(rng());
+	}
+	addrs.resize(addrs.size() - 5);
+
+	for (auto level : {simd_level::scalar, simd_level::sse2, simd_level::avx2, simd_level::avx512})
+	{
+		std::vector<uint32_t> out(addrs.size(), 0);
+		std::vector<uint8_t>  found(addrs.size(), 2);
+		dir.check_batch(addrs.data(), addrs.size(), out.data(), found.data(), level);
+		for (size_t i = 0; i < addrs.size(); ++i)
+		{
+			uint32_t expected = 0;
+			ASSERT_EQ(dir.check(addrs[i], expected), found[i] == 1)
+				<< cidr_v4(addrs[i], 32) << " level " << (int)level;
+			if (found[i])
+				EXPECT_EQ(expected, out[i]);
+		}
+	}
+}
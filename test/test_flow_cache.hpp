@@ -0,0 +1,120 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 01:10:47*/
+
+#include <iptools/flow_cache.hpp>
+#include <iptools/generator.hpp>
+
+using namespace iptools;
+
+TEST(test_flow_cache, same_as_tree)
+{
+	auto prefixes = generate_prefixes_v4(2000, 11);
+	basic_lpfst<uint32_t> tbl;
+	for (size_t i = 0; i < prefixes.size(); ++i)
+		tbl.insert(prefixes[i], static_cast<uint32_t>(i));
+	trace_profile profile;
+	profile.hit_ratio = 0.8;
+	profile.zipf = 1;
+	profile.flows = 2000;
+	auto trace = generate_trace_v4(prefixes, 20000, 12, profile);
+
+	lpfst_flow_cache<uint32_t> cache(tbl, 1000);
+	EXPECT_EQ(1024, cache.capacity());
+	for (uint32_t addr : trace)
+	{
+		uint32_t expected = 0xFFFFFFFF, data = 0xFFFFFFFF;
+		bool found = tbl.check(addr, expected);
+		ASSERT_EQ(found, cache.check(addr, data));
+		ASSERT_EQ(expected, data);
+	}
+	EXPECT_EQ(trace.size(), cache.hits() + cache.misses());
+	// skewed traffic is served mostly from the cache
+	EXPECT_GT(cache.hits(), cache.misses());
+}
+
+TEST(test_flow_cache, invalidation)
+{
+	basic_lpfst<int> tbl;
+	lpfst_flow_cache<int> cache(tbl, 64);
+	const uint32_t addr = 0x0A010203; // 10.1.2.3
+	int data = 0;
+	EXPECT_FALSE(cache.check(addr, data));
+	EXPECT_FALSE(cache.check(addr, data));
+	EXPECT_EQ(1, cache.hits());
+
+	tbl.insert({"10.0.0.0/8"}, 1);
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(1, data);
+	tbl.insert({"10.1.0.0/16"}, 2);
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(2, cache.hits());
+
+	tbl.remove({"10.1.0.0/16"});
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(1, data);
+	uint64_t generation = tbl.generation();
+	tbl.remove({"10.1.0.0/16"});
+	EXPECT_EQ(generation, tbl.generation());
+
+	// the copy has the same generation and content
+	basic_lpfst<int> other;
+	other.insert({"10.1.2.0/24"}, 3);
+	tbl = other;
+	EXPECT_EQ(other.generation(), tbl.generation());
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(3, data);
+
+	std::vector<std::pair<cidr_v4, int> > list = {{cidr_v4("10.0.0.0/8"), 4}};
+	tbl.assign(list.begin(), list.end());
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(4, data);
+
+	tbl.clear();
+	EXPECT_FALSE(cache.check(addr, data));
+	tbl = std::move(other);
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(3, data);
+}
+
+TEST(test_flow_cache, eviction)
+{
+	basic_lpfst<uint32_t> tbl;
+	tbl.insert({"0.0.0.0/1"}, 1);
+	tbl.insert({"128.0.0.0/1"}, 2);
+	lpfst_flow_cache<uint32_t> cache(tbl, 16);
+	uint32_t data = 0;
+	for (int round = 0; round < 3; ++round)
+	{
+		for (uint32_t i = 0; i < 10000; ++i)
+		{
+			uint32_t addr = i*2654435761U;
+			ASSERT_TRUE(cache.check(addr, data));
+			ASSERT_EQ(addr < 0x80000000U ? 1U : 2U, data);
+		}
+	}
+	EXPECT_LT(cache.hits(), cache.misses());
+}
+
+TEST(test_flow_cache, v6)
+{
+	basic_lpfst_v6<int> tbl;
+	tbl.insert({"2001:db8::/32"}, 1);
+	lpfst_v6_flow_cache<int> cache(tbl);
+	in6_addr_t addr = cidr_v6("2001:db8:1::1");
+	in6_addr_t miss = cidr_v6("2001:db9::1");
+	int data = 0;
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(1, data);
+	EXPECT_FALSE(cache.check(miss, data));
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_FALSE(cache.check(miss, data));
+	EXPECT_EQ(2, cache.hits());
+	tbl.insert({"2001:db8:1::/48"}, 2);
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(2, data);
+	cache.reset();
+	EXPECT_TRUE(cache.check(addr, data));
+	EXPECT_EQ(2, cache.hits());
+}
@@ -0,0 +1,124 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 22:48:05*/
+
+#include <iptools/generator.hpp>
+#include <iptools/lpfst.hpp>
+#include <map>
+
+using namespace iptools;
+
+TEST(test_generator, prefixes_v4)
+{
+	auto prefixes = generate_prefixes_v4(20000, 7);
+	ASSERT_EQ(20000, prefixes.size());
+	EXPECT_TRUE(prefixes == generate_prefixes_v4(20000, 7));
+	EXPECT_FALSE(prefixes == generate_prefixes_v4(20000, 8));
+
+	std::map<uint8_t, size_t> lens;
+	std::set<std::pair<uint32_t, uint8_t> > unique;
+	basic_lpfst<uint8_t> tbl;
+	for (const auto& p : prefixes)
+	{
+		++lens[p.mask()];
+		EXPECT_TRUE(p.is_net());
+		EXPECT_GE(p.first() >> 24, 1);
+		EXPECT_LE(p.first() >> 24, 223);
+		unique.insert(std::make_pair(p.first(), (uint8_t)p.mask()));
+	}
+	EXPECT_EQ(prefixes.size(), unique.size());
+	// /24 takes more than half of the BGP table
+	EXPECT_GT(lens[24], prefixes.size()/2);
+	EXPECT_GT(lens[22], lens[16]);
+
+	// some prefixes are nested into shorter ones
+	size_t nested = 0;
+	for (const auto& p : prefixes)
+		if (p.mask() < 24)
+			tbl.insert(p, 0);
+	for (const auto& p : prefixes)
+		if (p.mask() == 24 && tbl.find(p.first()))
+			++nested;
+	EXPECT_GT(nested, lens[24]/10);
+}
+
+TEST(test_generator, trace_v4)
+{
+	auto prefixes = generate_prefixes_v4(5000, 3);
+	std::vector<std::pair<cidr_v4, uint32_t> > list;
+	for (size_t i = 0; i < prefixes.size(); ++i)
+		list.emplace_back(prefixes[i], i);
+	basic_lpfst<uint32_t> tbl(list.begin(), list.end());
+
+	trace_profile profile;
+	profile.hit_ratio = 0.75;
+	profile.zipf      = 1.2;
+	auto trace = generate_trace_v4(prefixes, 20000, 4, profile);
+	ASSERT_EQ(20000, trace.size());
+	EXPECT_TRUE(trace == generate_trace_v4(prefixes, 20000, 4, profile));
+	size_t hits = 0;
+	std::map<uint32_t, size_t> popularity;
+	for (uint32_t addr : trace)
+	{
+		const uint32_t* data = tbl.find(addr);
+		if (data)
+			++popularity[*data];
+		if ((addr & 0xE0000000U) == 0xE0000000U)
+			EXPECT_EQ(nullptr, data);
+		else
+			++hits;
+	}
+	EXPECT_NEAR(0.75, (double)hits/trace.size(), 0.02);
+	// the most popular prefix gets much more than the uniform share
+	size_t top = 0;
+	for (const auto& p : popularity)
+		top = std::max(top, p.second);
+	EXPECT_GT(top, 20*hits/prefixes.size());
+}
+
+TEST(test_generator, v6)
+{
+	auto prefixes = generate_prefixes_v6(5000, 5);
+	ASSERT_EQ(5000, prefixes.size());
+	EXPECT_TRUE(prefixes == generate_prefixes_v6(5000, 5));
+	basic_lpfst_v6<uint8_t> tbl;
+	for (const auto& p : prefixes)
+	{
+		EXPECT_TRUE(p.is_net());
+		EXPECT_EQ(0x20, in6_addr_t(p)[0] & 0xE0);
+		tbl.insert(p, 1);
+	}
+	trace_profile profile;
+	profile.hit_ratio = 0.5;
+	auto trace = generate_trace_v6(prefixes, 10000, 6, profile);
+	size_t hits = 0;
+	for (const auto& addr : trace)
+	{
+		const uint8_t* data = tbl.find(addr);
+		if (addr[0] == 0xFD)
+			EXPECT_EQ(nullptr, data);
+		else
+			++hits;
+	}
+	EXPECT_NEAR(0.5, (double)hits/trace.size(), 0.03);
+}
+
+TEST(test_generator, flows)
+{
+	auto prefixes = generate_prefixes_v4(1000, 9);
+	trace_profile profile;
+	profile.zipf  = 1;
+	profile.flows = 100;
+	auto trace = generate_trace_v4(prefixes, 10000, 10, profile);
+	ASSERT_EQ(10000, trace.size());
+	EXPECT_TRUE(trace == generate_trace_v4(prefixes, 10000, 10, profile));
+	std::map<uint32_t, size_t> popularity;
+	for (uint32_t addr : trace)
+		++popularity[addr];
+	EXPECT_LE(popularity.size(), 100);
+	EXPECT_GT(popularity.size(), 50);
+
+	auto prefixes_v6 = generate_prefixes_v6(1000, 9);
+	auto trace_v6 = generate_trace_v6(prefixes_v6, 1000, 10, profile);
+	ASSERT_EQ(1000, trace_v6.size());
+	EXPECT_LE(std::set<in6_addr_t>(trace_v6.begin(), trace_v6.end()).size(), 100);
+}
@@ -0,0 +1,199 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261019 02:14:05*/
+
+#include <iptools/hybrid_lpfst.hpp>
+#include <iptools/generator.hpp>
+
+using namespace iptools;
+
+TEST(test_hybrid_lpfst, longest_prefix)
+{
+	basic_hybrid_lpfst<int> tbl;
+	tbl.insert({"10.0.0.0/8"}, 1);
+	tbl.insert({"10.0.0.5/32"}, 2);
+	tbl.insert({"10.0.0.6"}, 3);
+	tbl.insert({"10.0.0.0/24"}, 4);
+	tbl.insert({"192.168.1.1/32"}, 5);
+	EXPECT_EQ(5, tbl.size());
+	EXPECT_EQ(3, tbl.hosts().size());
+	EXPECT_EQ(2, tbl.trie().size());
+
+	int data = 0;
+	EXPECT_TRUE(tbl.check(0x0A000005, data));
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(tbl.check(0x0A000006, data));
+	EXPECT_EQ(3, data);
+	EXPECT_TRUE(tbl.check(0x0A000007, data));
+	EXPECT_EQ(4, data);
+	EXPECT_TRUE(tbl.check(0x0A010007, data));
+	EXPECT_EQ(1, data);
+	EXPECT_FALSE(tbl.check(0xC0A80102, data));
+	EXPECT_EQ(5, *tbl.find(0xC0A80101));
+
+	EXPECT_TRUE(tbl.check(cidr_v4("10.0.0.5/24"), data));  // host address
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(tbl.check(cidr_v4("10.0.0.0/16"), data));
+	EXPECT_EQ(1, data);
+	// the network covers only the host entry
+	EXPECT_TRUE(tbl.check(cidr_v4("192.168.0.0/16"), data));
+	EXPECT_FALSE(tbl.check(cidr_v4("192.169.0.0/16"), data));
+
+	tbl.insert({"10.0.0.5/32"}, 6);
+	EXPECT_EQ(5, tbl.size());
+	EXPECT_EQ(6, *tbl.find(0x0A000005));
+	tbl.remove({"10.0.0.5/32"});
+	EXPECT_EQ(4, *tbl.find(0x0A000005));
+	tbl.remove({"10.0.0.0/24"});
+	EXPECT_EQ(1, *tbl.find(0x0A000005));
+	EXPECT_EQ(3, tbl.size());
+
+	size_t cnt = 0;
+	tbl.for_each_prefix([&cnt](const cidr_v4&, int) { ++cnt; });
+	EXPECT_EQ(3, cnt);
+	tbl.clear();
+	EXPECT_TRUE(tbl.empty());
+	EXPECT_EQ(nullptr, tbl.find(0xC0A80101));
+}
+
+TEST(test_hybrid_lpfst, host_map)
+{
+	host_map<uint32_t, uint32_t> hosts;
+	std::vector<uint32_t> keys;
+	for (uint32_t i = 0; i < 5000; ++i)
+		keys.push_back(i*2654435761U);
+	for (uint32_t key : keys)
+		hosts.insert(key, key + 1);
+	EXPECT_EQ(keys.size(), hosts.size());
+	EXPECT_LE(hosts.size()*4, hosts.capacity()*3);
+	// remove every other key, the rest is still found after back shifts
+	for (size_t i = 0; i < keys.size(); i += 2)
+		EXPECT_TRUE(hosts.remove(keys[i]));
+	EXPECT_FALSE(hosts.remove(keys[0]));
+	EXPECT_EQ(keys.size()/2, hosts.size());
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		const uint32_t* data = hosts.find(keys[i]);
+		if (i % 2 == 0)
+		{
+			EXPECT_EQ(nullptr, data);
+		}
+		else
+		{
+			ASSERT_NE(nullptr, data);
+			EXPECT_EQ(keys[i] + 1, *data);
+		}
+	}
+	auto moved = std::move(hosts);
+	EXPECT_TRUE(hosts.empty());
+	EXPECT_EQ(nullptr, hosts.find(keys[1]));
+	EXPECT_EQ(keys[1] + 1, *moved.find(keys[1]));
+}
+
+TEST(test_hybrid_lpfst, same_as_lpfst)
+{
+	prefix_profile profile = prefix_profile::bgp_v4();
+	profile.lengths.push_back(std::make_pair(32, 1500000.));
+	auto prefixes = generate_prefixes_v4(20000, 21, profile);
+	std::vector<std::pair<cidr_v4, uint32_t> > list;
+	std::vector<std::pair<cidr_v4, uint32_t> > net_list;
+	std::map<uint32_t, uint32_t> hosts;
+	for (size_t i = 0; i < prefixes.size(); ++i)
+	{
+		list.emplace_back(prefixes[i], static_cast<uint32_t>(i));
+		if (prefixes[i].mask() == 32)
+			hosts[prefixes[i]] = static_cast<uint32_t>(i);
+		else
+			net_list.emplace_back(prefixes[i], static_cast<uint32_t>(i));
+	}
+	// the trie of the same prefixes in the same order is the reference,
+	// bulk loaded and inserted tries may differ in the dropped prefixes
+	basic_lpfst<uint32_t> nets(net_list.begin(), net_list.end());
+	basic_lpfst<uint32_t> nets_inserted;
+	for (const auto& p : net_list)
+		nets_inserted.insert(p.first, p.second);
+	EXPECT_GT(hosts.size(), prefixes.size()/2);
+	basic_hybrid_lpfst<uint32_t> tbl(list.begin(), list.end());
+	basic_hybrid_lpfst<uint32_t> inserted;
+	for (const auto& p : list)
+		inserted.insert(p.first, p.second);
+	EXPECT_EQ(hosts.size(), tbl.hosts().size());
+	EXPECT_EQ(hosts.size(), inserted.hosts().size());
+
+	trace_profile trace_profile;
+	trace_profile.hit_ratio = 0.9;
+	auto trace = generate_trace_v4(prefixes, 50000, 22, trace_profile);
+	for (const auto& h : hosts)
+		trace.push_back(h.first);
+	for (uint32_t addr : trace)
+	{
+		auto host = hosts.find(addr);
+		const uint32_t* expected = host != hosts.end() ? &host->second : nets.find(addr);
+		const uint32_t* data = tbl.find(addr);
+		ASSERT_EQ(expected == nullptr, data == nullptr);
+		if (data)
+			ASSERT_EQ(*expected, *data);
+		expected = host != hosts.end() ? &host->second : nets_inserted.find(addr);
+		data = inserted.find(addr);
+		ASSERT_EQ(expected == nullptr, data == nullptr);
+		if (data)
+			ASSERT_EQ(*expected, *data);
+	}
+	// hosts don't deepen the trie
+	basic_lpfst<uint32_t> plain(list.begin(), list.end());
+	EXPECT_LT(tbl.trie().stats().avg_depth, plain.stats().avg_depth);
+	EXPECT_EQ(tbl.trie().stats().bytes, tbl.trie().memory_footprint());
+	EXPECT_GT(tbl.memory_footprint(), tbl.trie().memory_footprint() + tbl.hosts().size()*sizeof(uint32_t)*2);
+}
+
+TEST(test_hybrid_lpfst, flow_cache_and_metrics)
+{
+	basic_hybrid_lpfst<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.instrumentation().set_sample_every(1);
+	tbl.insert({"10.0.0.0/8"}, 1);
+	tbl.insert({"10.0.0.1/32"}, 2);
+	flow_cache<uint32_t, basic_hybrid_lpfst<int, std::allocator<int>, lookup_metrics> > cache(tbl);
+	int data = 0;
+	EXPECT_TRUE(cache.check(0x0A000001, data));
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(cache.check(0x0A000002, data));
+	EXPECT_EQ(1, data);
+	EXPECT_EQ(2, tbl.instrumentation().hits());
+	EXPECT_EQ(2, tbl.instrumentation().latency().count());
+	tbl.remove({"10.0.0.1/32"});
+	EXPECT_TRUE(cache.check(0x0A000001, data));
+	EXPECT_EQ(1, data);
+	EXPECT_EQ(0, cache.hits());
+}
+
+TEST(test_hybrid_lpfst, trie_lookups_are_timed)
+{
+	basic_hybrid_lpfst<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.insert({"10.0.0.0/8"}, 1);
+	tbl.insert({"10.0.0.1/32"}, 2);
+	// every lookup misses the hash, the default sampling must still time them
+	for (uint32_t i = 0; i < 100000; ++i)
+		EXPECT_EQ(1, *tbl.find(0x0A000002 + (i & 0xFFFF)));
+	EXPECT_EQ(100000, tbl.instrumentation().hits());
+	EXPECT_GT(tbl.instrumentation().latency().count(), 0);
+	EXPECT_EQ(100000, tbl.instrumentation().visited());
+}
+
+TEST(test_hybrid_lpfst, v6)
+{
+	basic_hybrid_lpfst_v6<int> tbl;
+	tbl.insert({"2001:db8::/32"}, 1);
+	tbl.insert({"2001:db8::1/128"}, 2);
+	tbl.insert({"2001:db9::1"}, 3);
+	EXPECT_EQ(2, tbl.hosts().size());
+	int data = 0;
+	EXPECT_TRUE(tbl.check(in6_addr_t(cidr_v6("2001:db8::1")), data));
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(tbl.check(in6_addr_t(cidr_v6("2001:db8::2")), data));
+	EXPECT_EQ(1, data);
+	EXPECT_TRUE(tbl.check(cidr_v6("2001:db9::/32"), data));
+	EXPECT_FALSE(tbl.check(cidr_v6("2001:dba::/32"), data));
+	auto copy = tbl;
+	tbl.remove({"2001:db8::1/128"});
+	EXPECT_EQ(1, *tbl.find(in6_addr_t(cidr_v6("2001:db8::1"))));
+	EXPECT_EQ(2, *copy.find(in6_addr_t(cidr_v6("2001:db8::1"))));
+}
@@ -0,0 +1,193 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 23:58:36*/
+
+#include <iptools/instrumentation.hpp>
+#include <iptools/lpfst.hpp>
+#include <iptools/lpfst_v6.hpp>
+#include <thread>
+#include <type_traits>
+
+using namespace iptools;
+
+TEST(test_instrumentation, histogram_buckets)
+{
+	for (uint64_t v : {0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 31ULL, 32ULL, 33ULL, 1000ULL,
+	                   123456789ULL, 0xFFFFFFFFFFFFFFFFULL})
+	{
+		unsigned i = latency_histogram::bucket(v);
+		EXPECT_LT(i, (unsigned)latency_histogram::bucket_count);
+		EXPECT_LE(latency_histogram::lowest(i), v);
+		EXPECT_GE(latency_histogram::highest(i), v);
+		EXPECT_LE(latency_histogram::highest(i) - latency_histogram::lowest(i), v/16);
+	}
+	for (unsigned i = 1; i < latency_histogram::bucket_count; ++i)
+		EXPECT_EQ(latency_histogram::highest(i - 1) + 1, latency_histogram::lowest(i));
+}
+
+TEST(test_instrumentation, histogram_percentile)
+{
+	latency_histogram h;
+	EXPECT_EQ(0, h.percentile(0.5));
+	for (uint64_t v = 1; v <= 1000; ++v)
+		h.record(v);
+	EXPECT_EQ(1000, h.count());
+	EXPECT_EQ(500500, h.sum());
+	EXPECT_NEAR(500, (double)h.percentile(0.5), 500/16.);
+	EXPECT_NEAR(990, (double)h.percentile(0.99), 990/16.);
+	EXPECT_GE(h.percentile(1), 1000);
+	h.reset();
+	EXPECT_EQ(0, h.count());
+}
+
+TEST(test_instrumentation, disabled_is_free)
+{
+	EXPECT_TRUE(std::is_empty<no_instrumentation>::value);
+	EXPECT_EQ(sizeof(basic_lpfst<int>), sizeof(basic_lpfst<int, std::allocator<int>, no_instrumentation>));
+	// the empty base takes no space
+	struct plain
+	{
+		virtual ~plain() {}
+		std::vector<int> nodes;
+		uint32_t root, free;
+		size_t size;
+		uint64_t generation;
+	};
+	EXPECT_EQ(sizeof(plain), sizeof(basic_lpfst<int>));
+	// larger data gets the parallel array
+	EXPECT_EQ(sizeof(plain) + sizeof(std::vector<uint64_t>), sizeof(basic_lpfst<uint64_t>));
+}
+
+TEST(test_instrumentation, lpfst)
+{
+	basic_lpfst<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.instrumentation().set_sample_every(1);
+	tbl.insert({"10.0.0.0/8"}, 1);
+	tbl.insert({"10.1.0.0/16"}, 2);
+	tbl.insert({"192.168.0.0/16"}, 3);
+
+	int data = 0;
+	EXPECT_TRUE(tbl.check(0x0A010203, data));  // 10.1.2.3
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(tbl.check(0x0A020203, data));  // 10.2.2.3
+	EXPECT_EQ(1, data);
+	EXPECT_FALSE(tbl.check(0x0B000001, data)); // 11.0.0.1
+	EXPECT_TRUE(tbl.check({"192.168.1.1"}, data));
+	EXPECT_EQ(nullptr, tbl.find({"172.16.0.1"}));
+
+	const lookup_metrics& m = tbl.instrumentation();
+	EXPECT_EQ(3, m.hits());
+	EXPECT_EQ(2, m.misses());
+	EXPECT_GE(m.visited(), 5);
+	EXPECT_EQ(5, m.latency().count());
+
+	uint32_t addrs[] = {0x0A010203, 0x0B000001, 0xC0A80101};
+	int      out[3];
+	uint8_t  found[3];
+	tbl.check_batch(addrs, 3, out, found);
+	EXPECT_EQ(5, m.hits());
+	EXPECT_EQ(3, m.misses());
+	EXPECT_EQ(5, m.latency().count()); // batches are not timed
+
+	std::string text = m.str("acl");
+	EXPECT_NE(std::string::npos, text.find("acl_lookups_total{result=\"hit\"} 5\n"));
+	EXPECT_NE(std::string::npos, text.find("acl_lookups_total{result=\"miss\"} 3\n"));
+	EXPECT_NE(std::string::npos, text.find("acl_lookup_latency_ns{quantile=\"0.99\"} "));
+	EXPECT_NE(std::string::npos, text.find("acl_lookup_latency_ns_count 5\n"));
+
+	// a copy counts its own lookups, a moved tree keeps the settings
+	auto copy = tbl;
+	EXPECT_EQ(0, copy.instrumentation().hits());
+	EXPECT_EQ(1, copy.instrumentation().sample_every());
+	auto moved = std::move(copy);
+	EXPECT_TRUE(moved.check(0x0A010203, data));
+	EXPECT_EQ(1, moved.instrumentation().hits());
+	EXPECT_EQ(1, moved.instrumentation().latency().count());
+
+	// the moved tree takes the counters, the moved-from one still works
+	auto taken = std::move(moved);
+	EXPECT_EQ(1, taken.instrumentation().hits());
+	EXPECT_EQ(1, taken.instrumentation().latency().count());
+	moved.insert({"10.0.0.0/8"}, 1);
+	EXPECT_TRUE(moved.check(0x0A010203, data));
+	EXPECT_EQ(0, moved.instrumentation().hits());
+	moved = tbl;
+	EXPECT_TRUE(moved.check(0x0A010203, data));
+	EXPECT_EQ(1, moved.instrumentation().hits());
+	taken = std::move(moved);
+	EXPECT_EQ(1, taken.instrumentation().hits());
+	EXPECT_EQ(0, moved.instrumentation().hits());
+	EXPECT_TRUE(moved.empty());
+	EXPECT_TRUE((std::is_nothrow_move_constructible<basic_lpfst<int, std::allocator<int>, lookup_metrics> >::value));
+
+	tbl.instrumentation().reset();
+	EXPECT_EQ(0, m.hits());
+	EXPECT_EQ(0, m.latency().count());
+}
+
+TEST(test_instrumentation, sampling)
+{
+	basic_lpfst<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.instrumentation().set_sample_every(8);
+	tbl.insert({"10.0.0.0/8"}, 1);
+	for (uint32_t i = 0; i < 800; ++i)
+		tbl.find(0x0A000000 + i);
+	EXPECT_EQ(800, tbl.instrumentation().hits());
+	EXPECT_NEAR(100, (double)tbl.instrumentation().latency().count(), 1);
+}
+
+TEST(test_instrumentation, sampling_per_table)
+{
+	// lookups on one table don't shift the sampling of another
+	basic_lpfst<int, std::allocator<int>, lookup_metrics> a, b;
+	a.instrumentation().set_sample_every(8);
+	b.instrumentation().set_sample_every(1);
+	a.insert({"10.0.0.0/8"}, 1);
+	b.insert({"10.0.0.0/8"}, 1);
+	for (uint32_t i = 0; i < 800; ++i)
+	{
+		a.find(0x0A000000 + i);
+		b.find(0x0A000000 + i);
+	}
+	EXPECT_NEAR(100, (double)a.instrumentation().latency().count(), 1);
+	EXPECT_EQ(800, b.instrumentation().latency().count());
+}
+
+TEST(test_instrumentation, threads)
+{
+	basic_lpfst<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.insert({"10.0.0.0/8"}, 1);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 20; ++t)
+	{
+		threads.emplace_back([&tbl]()
+			{
+				for (uint32_t i = 0; i < 10000; ++i)
+					tbl.find(0x0A000000 + i*2);
+				for (uint32_t i = 0; i < 5000; ++i)
+					tbl.find(0x0B000000 + i);
+			});
+	}
+	for (auto& t : threads)
+		t.join();
+	EXPECT_EQ(200000, tbl.instrumentation().hits());
+	EXPECT_EQ(100000, tbl.instrumentation().misses());
+	EXPECT_EQ(300000, tbl.instrumentation().visited());
+	EXPECT_NE(std::string::npos, tbl.instrumentation().str().find("lpfst_lookups_total{result=\"hit\"} 200000\n"));
+}
+
+TEST(test_instrumentation, lpfst_v6)
+{
+	basic_lpfst_v6<int, std::allocator<int>, lookup_metrics> tbl;
+	tbl.instrumentation().set_sample_every(1);
+	tbl.insert({"2001:db8::/32"}, 1);
+	tbl.insert({"2001:db8:1::/48"}, 2);
+	int data = 0;
+	EXPECT_TRUE(tbl.check(in6_addr_t(cidr_v6("2001:db8:1::1")), data));
+	EXPECT_EQ(2, data);
+	EXPECT_FALSE(tbl.check(in6_addr_t(cidr_v6("2001:db9::1")), data));
+	EXPECT_TRUE(tbl.check(cidr_v6("2001:db8:2::/64"), data));
+	EXPECT_EQ(2, tbl.instrumentation().hits());
+	EXPECT_EQ(1, tbl.instrumentation().misses());
+	EXPECT_EQ(3, tbl.instrumentation().latency().count());
+	EXPECT_NE(std::string::npos, tbl.instrumentation().str().find("lpfst_nodes_visited_total "));
+}
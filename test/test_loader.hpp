@@ -0,0 +1,99 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 19:12:09*/
+
+#include <iptools/loader.hpp>
+#include <fcntl.h>
+
+using namespace iptools;
+
+static const char test_loader_list[] =
+	"# blacklist\n"
+	"10.0.0.0/8 1\n"
+	"\n"
+	"  192.168.3.0/24,\t2\r\n"
+	"192.168.3.17 3\n"
+	"300.1.1.1/8 4\n"
+	"10.0.2.0/33 5\n"
+	"10.0.2.0/24 x\n"
+	"213.1.2.0/24";
+
+static void
+test_loader_check(const basic_lpfst<uint32_t>& ipset, const load_stats& stats)
+{
+	EXPECT_EQ(9, stats.lines);
+	EXPECT_EQ(4, stats.loaded);
+	EXPECT_EQ(3, stats.invalid);
+	EXPECT_EQ(4, ipset.size());
+	uint32_t data = 7;
+	EXPECT_TRUE(ipset.check(ntohl(inet_addr("10.0.2.1")), data));
+	EXPECT_EQ(1, data);
+	EXPECT_TRUE(ipset.check(ntohl(inet_addr("192.168.3.1")), data));
+	EXPECT_EQ(2, data);
+	EXPECT_TRUE(ipset.check(ntohl(inet_addr("192.168.3.17")), data));
+	EXPECT_EQ(3, data);
+	EXPECT_TRUE(ipset.check(ntohl(inet_addr("213.1.2.1")), data));
+	EXPECT_EQ(0, data);
+	EXPECT_FALSE(ipset.check(ntohl(inet_addr("11.0.0.1")), data));
+}
+
+TEST(test_loader, memory)
+{
+	basic_lpfst<uint32_t> ipset;
+	load_stats stats;
+	load(test_loader_list, sizeof(test_loader_list) - 1, ipset, &stats);
+	test_loader_check(ipset, stats);
+}
+
+TEST(test_loader, fd)
+{
+	std::string path = "/tmp/iptools_test_loader_" + std::to_string(getpid());
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ASSERT_LE(0, fd);
+	ASSERT_EQ((ssize_t)sizeof(test_loader_list) - 1, ::write(fd, test_loader_list, sizeof(test_loader_list) - 1));
+	unlink(path.c_str());
+
+	// small chunks: lines span the chunk boundaries and the buffer grows
+	for (size_t chunk : {1, 7, 64, 1 << 20})
+	{
+		ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+		std::vector<std::string> lines;
+		ASSERT_TRUE(for_each_line(fd, [&lines](const char* first, const char* last)
+			{
+				lines.push_back(std::string(first, last));
+			}, chunk));
+		ASSERT_EQ(9, lines.size());
+		EXPECT_EQ("# blacklist", lines[0]);
+		EXPECT_EQ("", lines[2]);
+		EXPECT_EQ("213.1.2.0/24", lines[8]);
+	}
+
+	ASSERT_EQ(0, lseek(fd, 0, SEEK_SET));
+	basic_lpfst<uint32_t> ipset;
+	load_stats stats;
+	ASSERT_TRUE(load(fd, ipset, &stats));
+	test_loader_check(ipset, stats);
+	::close(fd);
+	EXPECT_FALSE(load(fd, ipset));
+	EXPECT_EQ(4, ipset.size());
+}
+
+TEST(test_loader, v6_with_strings)
+{
+	const char list[] =
+		"2001:db8::/32 doc\n"
+		"2001:db8:1::/48 doc-1\n"
+		"::1 localhost\n"
+		"2001:db8::/129 bad\n";
+	basic_lpfst_v6<std::string> ipset;
+	load_stats stats;
+	load(list, sizeof(list) - 1, ipset, &stats);
+	EXPECT_EQ(3, stats.loaded);
+	EXPECT_EQ(1, stats.invalid);
+	std::string data;
+	EXPECT_TRUE(ipset.check(cidr_v6("2001:db8:1::5").operator in6_addr_t(), data));
+	EXPECT_EQ("doc-1", data);
+	EXPECT_TRUE(ipset.check(cidr_v6("2001:db8:2::5").operator in6_addr_t(), data));
+	EXPECT_EQ("doc", data);
+	EXPECT_TRUE(ipset.check(cidr_v6("::1").operator in6_addr_t(), data));
+	EXPECT_EQ("localhost", data);
+}
@@ -2,6 +2,9 @@
  * @date 20160411 11:31:17*/
 
 #include <iptools/lpfst.hpp>
+#include <random>
+#include <map>
+#include <set>
 
 using namespace iptools;
 
@@ -543,3 +546,405 @@ TEST(test_lpfst, internet_blacklist)
 }
 
 
+
+TEST(test_lpfst, snapshot_check_cidr)
+{
+	basic_lpfst<int> ipset;
+	ipset.insert({"10.0.0.0/8"    }, 1);
+	ipset.insert({"192.168.3.0/24"}, 2);
+	ipset.insert({"127.0.0.1/24"  }, 3);
+	ipset.insert({"10.0.2.0/24"   }, 4);
+	ipset.insert({"213.1.2.0/24"  }, 5);
+	ipset.insert({"215.1.2.0/24"  }, 6);
+
+	basic_lpfst<int>::snapshot frozen = ipset.freeze();
+	ipset.clear();
+	EXPECT_EQ(6, frozen.size());
+
+	int rs = 0;
+	EXPECT_TRUE (frozen.check({"215.1.2.1/24"     }, rs));
+	EXPECT_EQ   (6, rs);
+	EXPECT_TRUE (frozen.check({"215.1.2.255/8"    }, rs));
+	EXPECT_FALSE(frozen.check({"215.0.0.0/8"      }, rs));
+	EXPECT_TRUE (frozen.check({"10.0.2.1/24"      }, rs));
+	EXPECT_EQ   (4, rs);
+	EXPECT_TRUE (frozen.check({"10.255.255.255/8" }, rs));
+	EXPECT_EQ   (1, rs);
+	EXPECT_FALSE(frozen.check({"10.0.0.0/7"       }, rs));
+	EXPECT_FALSE(frozen.check({"11.0.0.0/8"       }, rs));
+	EXPECT_FALSE(frozen.check({"192.168.1.1/24"   }, rs));
+}
+
+TEST(test_lpfst, snapshot_same_as_tree)
+{
+	std::mt19937 rng(20160411);
+	basic_lpfst<uint32_t> ipset;
+	EXPECT_TRUE(ipset.freeze().empty());
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		ipset.insert(cidr_v4(rng() >> (32 - len) << (32 - len), len), i);
+	}
+
+	auto frozen = ipset.freeze();
+	EXPECT_EQ(ipset.size(), frozen.size());
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t expected = 0, rs = 0;
+		bool found = ipset.check(addr, expected);
+		ASSERT_EQ(found, frozen.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, rs);
+		cidr_v4 net(addr >> 12 << 12, 20);
+		ASSERT_EQ(ipset.check(net, expected), frozen.check(net, rs)) << net;
+	}
+}
+
+TEST(test_lpfst, check_batch)
+{
+	std::mt19937 rng(20261020);
+	basic_lpfst<uint32_t> ipset;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		ipset.insert(cidr_v4(rng() >> (32 - len) << (32 - len), len), i);
+	}
+
+	std::vector<uint32_t> addrs(1003);
+	for (auto& addr : addrs)
+		addr = rng();
+	std::vector<uint32_t> out(addrs.size(), 0);
+	std::vector<uint8_t>  found(addrs.size(), 2);
+	ipset.check_batch(addrs.data(), addrs.size(), out.data(), found.data());
+	for (size_t i = 0; i < addrs.size(); ++i)
+	{
+		uint32_t expected = 0;
+		ASSERT_EQ(ipset.check(addrs[i], expected), found[i] == 1) << cidr_v4(addrs[i], 32);
+		if (found[i])
+			EXPECT_EQ(expected, out[i]);
+	}
+
+	basic_lpfst<uint32_t> empty;
+	empty.check_batch(addrs.data(), addrs.size(), out.data(), found.data());
+	EXPECT_EQ(addrs.size(), (size_t)std::count(found.begin(), found.end(), 0));
+}
+
+static size_t test_lpfst_allocations = 0;
+
+template<class T> struct counting_allocator
+{
+	using value_type = T;
+	counting_allocator() {}
+	template<class U> counting_allocator(const counting_allocator<U>&) {}
+	T* allocate(size_t n)
+	{
+		++test_lpfst_allocations;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+	template<class U> bool operator==(const counting_allocator<U>&) const { return true; }
+	template<class U> bool operator!=(const counting_allocator<U>&) const { return false; }
+};
+
+TEST(test_lpfst, arena)
+{
+	std::mt19937 rng(20261022);
+	std::vector<cidr_v4> prefixes;
+	for (uint32_t i = 0; i < 10000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		prefixes.emplace_back(rng() >> (32 - len) << (32 - len), len);
+	}
+
+	basic_lpfst<uint32_t, counting_allocator<uint32_t> > ipset;
+	test_lpfst_allocations = 0;
+	for (uint32_t i = 0; i < prefixes.size(); ++i)
+		ipset.insert(prefixes[i], i);
+	EXPECT_LT(test_lpfst_allocations, 32);
+
+	test_lpfst_allocations = 0;
+	auto copy = ipset;
+	EXPECT_EQ(1, test_lpfst_allocations); // the data is in the nodes
+	EXPECT_EQ(ipset.size(), copy.size());
+	for (size_t i = 0; i < 10000; ++i)
+	{
+		uint32_t addr = (uint32_t)prefixes[rng()%prefixes.size()] | (rng() & 0xFF);
+		uint32_t expected = 0, rs = 0;
+		bool found = ipset.check(addr, expected);
+		ASSERT_EQ(found, copy.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, rs);
+	}
+
+	// removed nodes are reused
+	for (size_t i = 0; i < prefixes.size(); i += 2)
+		ipset.remove(prefixes[i]);
+	test_lpfst_allocations = 0;
+	for (uint32_t i = 0; i < prefixes.size(); i += 2)
+		ipset.insert(prefixes[i], i);
+	EXPECT_EQ(0, test_lpfst_allocations);
+
+	copy.clear();
+	EXPECT_TRUE(copy.empty());
+	test_lpfst_allocations = 0;
+	for (uint32_t i = 0; i < prefixes.size(); ++i)
+		copy.insert(prefixes[i], i);
+	EXPECT_EQ(0, test_lpfst_allocations);
+}
+
+TEST(test_lpfst, for_each_prefix)
+{
+	basic_lpfst<std::string> ipset;
+	ipset.insert({"10.0.0.0/8"    }, "a");
+	ipset.insert({"192.168.3.0/24"}, "b");
+	ipset.insert({"10.0.2.0/24"   }, "c");
+	ipset.insert({"10.0.2.128/25" }, "d");
+
+	std::map<std::string, std::string> visited;
+	ipset.for_each_prefix([&visited](const cidr_v4& addr, const std::string& data)
+		{
+			visited[addr.str()] = data;
+		});
+	ASSERT_EQ(4, visited.size());
+	EXPECT_EQ("a", visited["10.0.0.0/8"]);
+	EXPECT_EQ("b", visited["192.168.3.0/24"]);
+	EXPECT_EQ("c", visited["10.0.2.0/24"]);
+	EXPECT_EQ("d", visited["10.0.2.128/25"]);
+	std::string printed = ipset.print();
+	EXPECT_EQ(3, std::count(printed.begin(), printed.end(), '\n'));
+}
+
+TEST(test_lpfst, deep_tree)
+{
+	// every host of 10.0.0.0/22 produces the tree of the maximal depth
+	basic_lpfst<uint32_t> ipset;
+	cidr_v4 net("10.0.0.0/22");
+	for (uint32_t i = 0; i < 1024; ++i)
+		ipset.insert(cidr_v4(net.first() + i, 32), i);
+	size_t cnt = 0;
+	ipset.for_each_prefix([&cnt](const cidr_v4&, uint32_t) { ++cnt; });
+	EXPECT_EQ(ipset.size(), cnt);
+	uint32_t rs = 0;
+	EXPECT_TRUE(ipset.check(net.first() + 1000, rs));
+	EXPECT_EQ(1000, rs);
+	for (uint32_t i = 0; i < 1024; ++i)
+		ipset.remove(cidr_v4(net.first() + i, 32));
+	EXPECT_FALSE(ipset.check(net.first() + 1000, rs));
+}
+
+TEST(test_lpfst, bulk_load)
+{
+	std::mt19937 rng(20261021);
+	std::vector<std::pair<cidr_v4, uint32_t> > list;
+	for (uint32_t i = 0; i < 20000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		list.push_back({cidr_v4(rng() >> (32 - len) << (32 - len), len), i});
+	}
+	list.push_back({cidr_v4("10.1.0.0/16"), 1});
+	list.push_back({cidr_v4("10.1.0.0/16"), 2});
+
+	basic_lpfst<uint32_t> ipset(list.begin(), list.end());
+	uint32_t data = 0;
+	EXPECT_TRUE(ipset.check(cidr_v4("10.1.0.1"), data));
+	EXPECT_EQ(2, data);
+
+	// lookups are longest prefix match over the stored prefixes
+	std::map<std::pair<uint8_t, uint32_t>, uint32_t> stored;
+	ipset.for_each_prefix([&stored](const cidr_v4& addr, uint32_t data)
+		{
+			stored[std::make_pair(addr.mask(), (uint32_t)addr)] = data;
+		});
+	EXPECT_EQ(stored.size(), ipset.size());
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		uint32_t addr = rng();
+		bool found = false;
+		uint32_t expected = 0;
+		for (uint8_t len = 32; len >= 8 && !found; --len)
+		{
+			auto it = stored.find(std::make_pair(len, addr >> (32 - len) << (32 - len)));
+			if (it != stored.end())
+			{
+				found = true;
+				expected = it->second;
+			}
+		}
+		ASSERT_EQ(found, ipset.check(addr, data)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, data);
+	}
+
+	// prefixes of the same length are never dropped, same as inserted
+	std::vector<std::pair<cidr_v4, uint32_t> > same;
+	std::set<uint32_t> used;
+	basic_lpfst<uint32_t> inserted;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint32_t prefix = rng() >> 8 << 8;
+		if (!used.insert(prefix).second)
+			continue;
+		same.push_back({cidr_v4(prefix, 24), i});
+		inserted.insert(same.back().first, i);
+	}
+	ipset.assign(same.begin(), same.end());
+	EXPECT_EQ(inserted.size(), ipset.size());
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t expected = 0;
+		bool found = inserted.check(addr, expected);
+		ASSERT_EQ(found, ipset.check(addr, data)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, data);
+	}
+}
+
+TEST(test_lpfst, move_only_data)
+{
+	basic_lpfst<std::unique_ptr<std::string> > ipset;
+	ipset.insert({"10.0.0.0/8"     }, std::unique_ptr<std::string>(new std::string("a")));
+	ipset.emplace({"10.0.2.0/24"   }, new std::string("b"));
+	ipset.emplace({"10.0.2.128/25" }, new std::string("c"));
+	ipset.emplace({"192.168.3.0/24"}, new std::string("d"));
+	ipset.remove({"10.0.2.0/24"});
+	EXPECT_EQ(3, ipset.size());
+
+	auto rs = ipset.find(cidr_v4("10.0.2.129").net());
+	ASSERT_NE(nullptr, rs);
+	EXPECT_EQ("c", **rs);
+	rs = ipset.find(ntohl(inet_addr("10.0.2.1")));
+	ASSERT_NE(nullptr, rs);
+	EXPECT_EQ("a", **rs);
+	EXPECT_EQ(nullptr, ipset.find(ntohl(inet_addr("11.0.0.1"))));
+	// the network covers a prefix, but has no data
+	EXPECT_EQ(nullptr, ipset.find(cidr_v4("192.168.0.0/16")));
+
+	std::vector<std::pair<cidr_v4, std::unique_ptr<std::string> > > list;
+	list.emplace_back(cidr_v4("172.16.0.0/12"), std::unique_ptr<std::string>(new std::string("e")));
+	ipset.assign(std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+	ASSERT_NE(nullptr, ipset.find(ntohl(inet_addr("172.17.0.1"))));
+	EXPECT_EQ(nullptr, ipset.find(ntohl(inet_addr("10.0.0.1"))));
+}
+
+TEST(test_lpfst, large_data)
+{
+	// the data is kept apart from the nodes, it moves with its prefix when
+	// remove() pushes the node down
+	struct payload
+	{
+		uint32_t id{0};
+		char     pad[252];
+	};
+	std::mt19937 rng(20261025);
+	std::vector<cidr_v4> prefixes;
+	for (uint32_t i = 0; i < 2000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		prefixes.emplace_back(rng() >> (32 - len) << (32 - len), len);
+	}
+	basic_lpfst<payload> ipset;
+	basic_lpfst<uint32_t> expected;
+	for (uint32_t i = 0; i < prefixes.size(); ++i)
+	{
+		payload data;
+		data.id = i;
+		ipset.insert(prefixes[i], data);
+		expected.insert(prefixes[i], i);
+	}
+	for (size_t i = 0; i < prefixes.size(); i += 3)
+	{
+		ipset.remove(prefixes[i]);
+		expected.remove(prefixes[i]);
+	}
+	EXPECT_EQ(expected.size(), ipset.size());
+	EXPECT_GE(ipset.stats().bytes, ipset.size()*sizeof(payload));
+	for (size_t i = 0; i < 10000; ++i)
+	{
+		uint32_t addr = (uint32_t)prefixes[rng()%prefixes.size()] | (rng() & 0xFF);
+		const uint32_t* rs = expected.find(addr);
+		const payload* data = ipset.find(addr);
+		ASSERT_EQ(rs == nullptr, data == nullptr);
+		if (rs)
+			ASSERT_EQ(*rs, data->id);
+	}
+}
+
+TEST(test_lpfst, move)
+{
+	basic_lpfst<std::string> ipset;
+	ipset.insert({"10.0.0.0/8"}, "a");
+	ipset.insert({"10.0.2.0/24"}, "b");
+
+	basic_lpfst<std::string> moved(std::move(ipset));
+	EXPECT_EQ(2, moved.size());
+	EXPECT_EQ(0, ipset.size());
+	EXPECT_TRUE(ipset.empty());
+	EXPECT_EQ(nullptr, ipset.find(ntohl(inet_addr("10.0.0.1"))));
+	std::string rs;
+	EXPECT_TRUE(moved.check(ntohl(inet_addr("10.0.2.1")), rs));
+	EXPECT_EQ("b", rs);
+
+	ipset.insert({"192.168.0.0/16"}, "c");
+	ipset = std::move(moved);
+	EXPECT_TRUE(moved.empty());
+	EXPECT_FALSE(ipset.check(ntohl(inet_addr("192.168.0.1")), rs));
+	EXPECT_TRUE(ipset.check(ntohl(inet_addr("10.1.0.1")), rs));
+	EXPECT_EQ("a", rs);
+
+	lpfst blacklist = internet_blacklist();
+	EXPECT_TRUE(blacklist.check(cidr_v4("10.1.1.1")));
+}
+
+TEST(test_lpfst, remove_missing_keeps_size)
+{
+	basic_lpfst<int> ipset;
+	ipset.insert({"10.0.0.0/8"}, 1);
+	ipset.insert({"10.0.2.0/24"}, 2);
+	ipset.remove({"192.168.0.0/16"});
+	ipset.remove({"10.0.3.0/24"});
+	EXPECT_EQ(2, ipset.size());
+	ipset.remove({"10.0.2.0/24"});
+	EXPECT_EQ(1, ipset.size());
+	ipset.remove({"10.0.2.0/24"});
+	EXPECT_EQ(1, ipset.size());
+}
+
+TEST(test_lpfst, stats)
+{
+	basic_lpfst<int> ipset;
+	lpfst_stats rs = ipset.stats();
+	EXPECT_EQ(0, rs.nodes);
+	EXPECT_EQ(0, rs.max_depth);
+
+	ipset.insert({"10.0.0.0/8"     }, 1);
+	ipset.insert({"10.0.2.0/24"    }, 2);
+	ipset.insert({"10.0.2.128/25"  }, 3);
+	ipset.insert({"192.168.3.0/24" }, 4);
+	ipset.insert({"192.168.3.17/32"}, 5);
+	ipset.remove({"192.168.3.0/24"});
+	rs = ipset.stats();
+	EXPECT_EQ(ipset.size(), rs.nodes);
+	EXPECT_EQ(1, rs.free_nodes);
+	EXPECT_GE(rs.bytes, 5*(sizeof(int) + 2*sizeof(uint32_t)));
+	EXPECT_EQ(rs.bytes, ipset.memory_footprint());
+	EXPECT_EQ(1, rs.levels[0]);
+	EXPECT_EQ(rs.max_depth, rs.levels.size());
+	size_t nodes = 0, visited = 0, leaves = 0;
+	for (size_t i = 0; i < rs.levels.size(); ++i)
+	{
+		nodes += rs.levels[i];
+		visited += rs.levels[i]*(i + 1);
+		leaves += rs.leaves[i];
+		EXPECT_LE(rs.leaves[i], rs.levels[i]);
+	}
+	EXPECT_EQ(rs.nodes, nodes);
+	EXPECT_GT(leaves, 0);
+	EXPECT_DOUBLE_EQ((double)visited/nodes, rs.avg_depth);
+	ASSERT_EQ(33, rs.lengths.size());
+	EXPECT_EQ(1, rs.lengths[8]);
+	EXPECT_EQ(1, rs.lengths[24]);
+	EXPECT_EQ(1, rs.lengths[25]);
+	EXPECT_EQ(1, rs.lengths[32]);
+}
@@ -0,0 +1,68 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 17:48:03*/
+
+#include <iptools/lpfst_image.hpp>
+#include <random>
+
+using namespace iptools;
+
+TEST(test_lpfst_image, same_as_snapshot)
+{
+	std::mt19937 rng(20261022);
+	basic_lpfst<uint32_t> ipset;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		ipset.insert(cidr_v4(rng() >> (32 - len) << (32 - len), len), i);
+	}
+	auto frozen = ipset.freeze();
+	std::string path = "/tmp/iptools_test_image_" + std::to_string(getpid());
+	ASSERT_TRUE(write_lpfst_image(frozen, path.c_str()));
+
+	basic_lpfst_image<uint32_t> image;
+	ASSERT_TRUE(image.open(path.c_str()));
+	unlink(path.c_str());
+	EXPECT_EQ(frozen.size(), image.size());
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t expected = 0, rs = 0;
+		bool found = frozen.check(addr, expected);
+		ASSERT_EQ(found, image.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(expected, rs);
+		cidr_v4 net(addr >> 12 << 12, 20);
+		ASSERT_EQ(frozen.check(net, expected), image.check(net, rs)) << net;
+	}
+}
+
+TEST(test_lpfst_image, invalid)
+{
+	basic_lpfst_image<uint32_t> image;
+	EXPECT_FALSE(image.open("/nonexistent/iptools.img"));
+
+	basic_lpfst<uint64_t> ipset;
+	ipset.insert({"10.0.0.0/8"}, 1);
+	std::string path = "/tmp/iptools_test_image_" + std::to_string(getpid());
+	ASSERT_TRUE(write_lpfst_image(ipset.freeze(), path.c_str()));
+	// value size mismatch
+	EXPECT_FALSE(image.open(path.c_str()));
+	EXPECT_TRUE(image.empty());
+
+	basic_lpfst_image<uint64_t> image64;
+	ASSERT_TRUE(image64.open(path.c_str()));
+	uint64_t data = 0;
+	EXPECT_TRUE(image64.check(ntohl(inet_addr("10.1.1.1")), data));
+	EXPECT_EQ(1, data);
+
+	// truncated
+	ASSERT_EQ(0, truncate(path.c_str(), sizeof(lpfst_image_header) + 4));
+	EXPECT_FALSE(image64.open(path.c_str()));
+	unlink(path.c_str());
+
+	ASSERT_TRUE(write_lpfst_image(basic_lpfst<uint64_t>().freeze(), path.c_str()));
+	ASSERT_TRUE(image64.open(path.c_str()));
+	EXPECT_TRUE(image64.empty());
+	EXPECT_FALSE(image64.check(ntohl(inet_addr("10.1.1.1")), data));
+	unlink(path.c_str());
+}
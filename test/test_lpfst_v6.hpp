@@ -4,6 +4,7 @@
 #include "iptools/cidr_v6.hpp"
 #include <iptools/lpfst_v6.hpp>
 #include <fstream>
+#include <random>
 
 using namespace iptools;
 
@@ -131,3 +132,105 @@ TEST(tgest_lpfst_v6, all_ipv6_inet)
 		std::cout << print(ipset, a) << std::endl;
 }
 /***/
+
+TEST(test_lpfst_v6, check_batch)
+{
+	std::mt19937 rng(20261020);
+	basic_lpfst_v6<uint32_t> ipset;
+	std::vector<in6_addr_t> addrs;
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		in6_addr_t addr;
+		for (auto& b : addr)
+			b = static_cast<uint8_t>(rng());
+		addr[0] = 0x20;
+		ipset.insert(cidr_v6(addr, 16 + rng()%113).net(), i);
+		addr[15] ^= static_cast<uint8_t>(rng());
+		addrs.push_back(addr);
+	}
+
+	std::vector<uint32_t> out(addrs.size(), 0);
+	std::vector<uint8_t>  found(addrs.size(), 2);
+	ipset.check_batch(addrs.data(), addrs.size(), out.data(), found.data());
+	for (size_t i = 0; i < addrs.size(); ++i)
+	{
+		uint32_t expected = 0;
+		ASSERT_EQ(ipset.check(addrs[i], expected), found[i] == 1) << addrs[i];
+		if (found[i])
+			EXPECT_EQ(expected, out[i]);
+	}
+}
+
+TEST(test_lpfst_v6, bulk_load)
+{
+	std::mt19937 rng(20261021);
+	std::vector<std::pair<cidr_v6, uint32_t>> list;
+	std::vector<in6_addr_t> addrs;
+	for (uint32_t i = 0; i < 3000; ++i)
+	{
+		in6_addr_t addr;
+		for (auto& b : addr)
+			b = static_cast<uint8_t>(rng());
+		addr[0] = 0x20;
+		list.push_back({cidr_v6(addr, 48).net(), i});
+		addr[15] ^= static_cast<uint8_t>(rng());
+		addrs.push_back(addr);
+	}
+
+	// prefixes of the same length are never dropped, same as inserted
+	basic_lpfst_v6<uint32_t> ipset(list.begin(), list.end());
+	basic_lpfst_v6<uint32_t> inserted;
+	for (const auto& p : list)
+		inserted.insert(p.first, p.second);
+	EXPECT_EQ(inserted.size(), ipset.size());
+	for (const auto& addr : addrs)
+	{
+		uint32_t expected = 0, data = 0;
+		ASSERT_TRUE(inserted.check(addr, expected)) << addr;
+		ASSERT_TRUE(ipset.check(addr, data)) << addr;
+		EXPECT_EQ(expected, data);
+	}
+}
+
+TEST(test_lpfst_v6, move_only_data)
+{
+	basic_lpfst_v6<std::unique_ptr<std::string> > ipset;
+	ipset.emplace({"2001:db8::/32"  }, new std::string("a"));
+	ipset.emplace({"2001:db8:1::/48"}, new std::string("b"));
+	ipset.emplace({"fc00::/8"       }, new std::string("c"));
+	EXPECT_EQ(3, ipset.size());
+
+	auto rs = ipset.find(in6_addr_t(cidr_v6("2001:db8:1::5")));
+	ASSERT_NE(nullptr, rs);
+	EXPECT_EQ("b", **rs);
+	rs = ipset.find(cidr_v6("2001:db8:2::/48"));
+	ASSERT_NE(nullptr, rs);
+	EXPECT_EQ("a", **rs);
+	EXPECT_EQ(nullptr, ipset.find(in6_addr_t(cidr_v6("2002::1"))));
+
+	basic_lpfst_v6<std::unique_ptr<std::string> > moved(std::move(ipset));
+	EXPECT_TRUE(ipset.empty());
+	EXPECT_EQ(3, moved.size());
+	ipset = std::move(moved);
+	ASSERT_NE(nullptr, ipset.find(in6_addr_t(cidr_v6("fc00::1"))));
+}
+
+TEST(test_lpfst_v6, stats)
+{
+	basic_lpfst_v6<int> ipset;
+	ipset.insert({"2001:db8::/32"  }, 1);
+	ipset.insert({"2001:db8:1::/48"}, 2);
+	ipset.insert({"fc00::/8"       }, 3);
+	ipset.insert({"fc00::1"        }, 4);
+	ipset.remove({"2002::/16"});
+	EXPECT_EQ(4, ipset.size());
+	lpfst_stats rs = ipset.stats();
+	EXPECT_EQ(4, rs.nodes);
+	EXPECT_EQ(0, rs.free_nodes);
+	EXPECT_GT(rs.max_depth, 1);
+	EXPECT_EQ(1, rs.lengths[128]);
+	EXPECT_EQ(1, rs.lengths[48]);
+	ipset.remove({"fc00::1"});
+	EXPECT_EQ(3, ipset.size());
+	EXPECT_EQ(1, ipset.stats().free_nodes);
+}
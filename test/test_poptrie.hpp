@@ -0,0 +1,101 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 11:02:15*/
+
+#include <iptools/poptrie.hpp>
+#include <random>
+
+using namespace iptools;
+
+TEST(test_poptrie, simple_check_uint32)
+{
+	basic_lpfst<std::string> ipset;
+	ipset.insert({"10.0.0.0/8"     }, "a");
+	ipset.insert({"10.0.2.0/24"    }, "b");
+	ipset.insert({"10.0.2.128/25"  }, "c");
+	ipset.insert({"192.168.3.0/24" }, "d");
+	ipset.insert({"192.168.3.17/32"}, "e");
+	ipset.insert({"192.168.3.18/31"}, "f");
+
+	basic_poptrie<std::string> trie(ipset);
+	EXPECT_EQ(6, trie.size());
+
+	std::string rs;
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("10.1.2.3"     )), rs));
+	EXPECT_EQ   ("a", rs);
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("10.0.2.3"     )), rs));
+	EXPECT_EQ   ("b", rs);
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("10.0.2.129"   )), rs));
+	EXPECT_EQ   ("c", rs);
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("192.168.3.16" )), rs));
+	EXPECT_EQ   ("d", rs);
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("192.168.3.17" )), rs));
+	EXPECT_EQ   ("e", rs);
+	EXPECT_TRUE (trie.check(ntohl(inet_addr("192.168.3.19" )), rs));
+	EXPECT_EQ   ("f", rs);
+	EXPECT_FALSE(trie.check(ntohl(inet_addr("11.0.0.1"     )), rs));
+	EXPECT_FALSE(trie.check(ntohl(inet_addr("192.168.4.1"  )), rs));
+
+	basic_poptrie<std::string> empty;
+	EXPECT_TRUE (empty.empty());
+	EXPECT_FALSE(empty.check(ntohl(inet_addr("10.1.2.3")), rs));
+}
+
+TEST(test_poptrie, same_as_lpfst)
+{
+	std::mt19937 rng(20261018);
+	basic_lpfst<uint32_t> ipset;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t len = 8 + rng()%25;
+		ipset.insert(cidr_v4(rng() >> (32 - len) << (32 - len), len), i);
+	}
+
+	basic_poptrie<uint32_t>    trie(ipset);
+	basic_poptrie<uint32_t, 4> trie4(ipset);
+	EXPECT_EQ(ipset.size(), trie.size());
+	for (size_t i = 0; i < 200000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t expected = 0, rs = 0, rs4 = 0;
+		bool found = ipset.check(addr, expected);
+		ASSERT_EQ(found, trie.check(addr, rs)) << cidr_v4(addr, 32);
+		ASSERT_EQ(found, trie4.check(addr, rs4)) << cidr_v4(addr, 32);
+		if (found)
+		{
+			EXPECT_EQ(expected, rs);
+			EXPECT_EQ(expected, rs4);
+		}
+	}
+}
+
+TEST(test_poptrie, same_as_lpfst_v6)
+{
+	std::mt19937 rng(20261018);
+	basic_lpfst_v6<uint32_t> ipset;
+	std::vector<in6_addr_t> prefixes;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		in6_addr_t addr;
+		for (auto& b : addr)
+			b = static_cast<uint8_t>(rng());
+		addr[0] = 0x20;
+		uint8_t len = 16 + rng()%113;
+		cidr_v6 net = cidr_v6(addr, len).net();
+		ipset.insert(net, i);
+		prefixes.push_back(addr);
+	}
+
+	basic_poptrie_v6<uint32_t> trie(ipset);
+	EXPECT_EQ(ipset.size(), trie.size());
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		in6_addr_t addr = prefixes[rng()%prefixes.size()];
+		for (size_t j = 16 - rng()%16; j < 16; ++j)
+			addr[j] = static_cast<uint8_t>(rng());
+		uint32_t expected = 0, rs = 0;
+		bool found = ipset.check(addr, expected);
+		ASSERT_EQ(found, trie.check(addr, rs)) << addr;
+		if (found)
+			EXPECT_EQ(expected, rs);
+	}
+}
@@ -0,0 +1,146 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 18:30:44*/
+
+#include <iptools/shm_lpfst.hpp>
+#include <iptools/lpfst.hpp>
+#include <random>
+#include <set>
+#include <thread>
+#include <sys/wait.h>
+
+using namespace iptools;
+
+static std::string
+test_shm_lpfst_name()
+{
+	return "/iptools_test_" + std::to_string(getpid());
+}
+
+TEST(test_shm_lpfst, same_as_lpfst)
+{
+	std::string name = test_shm_lpfst_name();
+	basic_shm_lpfst<uint32_t> writer;
+	ASSERT_TRUE(writer.create(name.c_str(), 6000));
+	basic_shm_lpfst<uint32_t> reader;
+	ASSERT_TRUE(reader.open(name.c_str()));
+	EXPECT_FALSE(reader.insert({"10.0.0.0/8"}, 1));
+
+	std::mt19937 rng(20261023);
+	basic_lpfst<uint32_t> expected;
+	std::set<uint32_t> used;
+	std::vector<cidr_v4> inserted;
+	for (uint32_t i = 0; i < 5000; ++i)
+	{
+		uint8_t  len = 8 + rng()%25;
+		uint32_t prefix = rng() >> (32 - len) << (32 - len);
+		if (!used.insert(prefix).second)
+			continue;
+		inserted.push_back(cidr_v4(prefix, len));
+		expected.insert(inserted.back(), i);
+		ASSERT_TRUE(writer.insert(inserted.back(), i));
+	}
+	for (size_t i = 0; i < inserted.size(); i += 3)
+	{
+		expected.remove(inserted[i]);
+		writer.remove(inserted[i]);
+	}
+	size_t count = 0;
+	expected.for_each_prefix([&count](const cidr_v4&, uint32_t) { ++count; });
+	EXPECT_EQ(count, reader.size());
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		uint32_t addr = rng();
+		uint32_t data = 0, rs = 0;
+		bool found = expected.check(addr, data);
+		ASSERT_EQ(found, reader.check(addr, rs)) << cidr_v4(addr, 32);
+		if (found)
+			EXPECT_EQ(data, rs);
+		cidr_v4 net(addr >> 12 << 12, 20);
+		ASSERT_EQ(expected.check(net, data), reader.check(net, rs)) << net;
+	}
+
+	writer.clear();
+	EXPECT_TRUE(reader.empty());
+	uint32_t data = 0;
+	EXPECT_FALSE(reader.check(inserted[1], data));
+	basic_shm_lpfst<uint32_t>::unlink(name.c_str());
+}
+
+TEST(test_shm_lpfst, capacity)
+{
+	std::string name = test_shm_lpfst_name();
+	basic_shm_lpfst<uint64_t> ipset;
+	ASSERT_TRUE(ipset.create(name.c_str(), 2));
+	EXPECT_TRUE (ipset.insert({"10.0.0.0/8"    }, 1));
+	EXPECT_TRUE (ipset.insert({"192.168.0.0/16"}, 2));
+	EXPECT_FALSE(ipset.insert({"172.16.0.0/12" }, 3));
+	// the full segment still updates the existing prefix
+	EXPECT_TRUE (ipset.insert({"192.168.0.0/16"}, 4));
+	uint64_t data = 0;
+	EXPECT_TRUE(ipset.check(cidr_v4("192.168.1.1"), data));
+	EXPECT_EQ(4, data);
+	ipset.remove({"10.0.0.0/8"});
+	EXPECT_TRUE (ipset.insert({"172.16.0.0/12" }, 3));
+	EXPECT_EQ(2, ipset.size());
+
+	basic_shm_lpfst<uint32_t> wrong;
+	EXPECT_FALSE(wrong.open(name.c_str()));
+
+	// recreating doesn't touch the segment mapped by the reader
+	basic_shm_lpfst<uint64_t> reader;
+	ASSERT_TRUE(reader.open(name.c_str()));
+	basic_shm_lpfst<uint64_t> writer;
+	ASSERT_TRUE(writer.create(name.c_str(), 16));
+	EXPECT_TRUE(writer.empty());
+	EXPECT_EQ(2, reader.size());
+	EXPECT_EQ(2, reader.capacity());
+	EXPECT_TRUE(reader.check(cidr_v4("172.16.0.1"), data));
+	EXPECT_EQ(3, data);
+	writer.close();
+	basic_shm_lpfst<uint64_t>::unlink(name.c_str());
+	EXPECT_FALSE(wrong.open(name.c_str()));
+}
+
+TEST(test_shm_lpfst, readers_while_writing)
+{
+	std::string name = test_shm_lpfst_name();
+	basic_shm_lpfst<uint32_t> writer;
+	ASSERT_TRUE(writer.create(name.c_str(), 1024));
+	std::vector<cidr_v4> volatile_;
+	for (uint32_t i = 0; i < 256; i += 2)
+	{
+		writer.insert(cidr_v4((10U << 24) | (i << 16), 16), i);
+		volatile_.push_back(cidr_v4((10U << 24) | ((i + 1) << 16) | (i << 8), 24));
+	}
+
+	// the reader process checks that stable prefixes are always visible
+	pid_t pid = fork();
+	ASSERT_NE(-1, pid);
+	if (pid == 0)
+	{
+		basic_shm_lpfst<uint32_t> reader;
+		if (!reader.open(name.c_str()))
+			_exit(2);
+		std::mt19937 rng(1);
+		for (size_t n = 0; n < 2000000; ++n)
+		{
+			uint32_t i = rng() & 0xFE;
+			uint32_t data = 0;
+			if (!reader.check((10U << 24) | (i << 16) | (rng() & 0xFFFF), data) || data != i)
+				_exit(1);
+		}
+		_exit(0);
+	}
+	for (int round = 0; round < 200; ++round)
+	{
+		for (const auto& net : volatile_)
+			writer.insert(net, 1000);
+		for (const auto& net : volatile_)
+			writer.remove(net);
+	}
+	int status = 0;
+	ASSERT_EQ(pid, waitpid(pid, &status, 0));
+	EXPECT_TRUE(WIFEXITED(status));
+	EXPECT_EQ(0, WEXITSTATUS(status));
+	basic_shm_lpfst<uint32_t>::unlink(name.c_str());
+}
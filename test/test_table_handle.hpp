@@ -0,0 +1,111 @@
+/**@author hoxnox <hoxnox@gmail.com>
+ * @date 20261018 16:34:52*/
+
+#include <iptools/table_handle.hpp>
+#include <iptools/lpfst.hpp>
+#include <thread>
+
+using namespace iptools;
+
+static basic_lpfst<uint32_t>::snapshot
+test_table_handle_build(uint32_t version)
+{
+	basic_lpfst<uint32_t> rs;
+	for (uint32_t i = 0; i < 256; ++i)
+		rs.insert(cidr_v4((10U << 24) | (i << 16), 16), version);
+	return rs.freeze();
+}
+
+TEST(test_table_handle, publish)
+{
+	table_handle<basic_lpfst<uint32_t>::snapshot> handle;
+	auto reader = handle.make_reader();
+	uint32_t data = 0;
+	EXPECT_EQ(0, handle.version());
+	EXPECT_FALSE(reader.check(ntohl(inet_addr("10.1.2.3")), data));
+
+	uint64_t swapped = 0;
+	handle.on_swap([&swapped](const basic_lpfst<uint32_t>::snapshot& table, uint64_t version)
+		{
+			EXPECT_EQ(256, table.size());
+			swapped = version;
+		});
+	handle.publish(test_table_handle_build(7));
+	EXPECT_EQ(1, handle.version());
+	EXPECT_EQ(1, swapped);
+	EXPECT_TRUE(reader.check(ntohl(inet_addr("10.1.2.3")), data));
+	EXPECT_EQ(7, data);
+	EXPECT_EQ(256, reader.read([](const basic_lpfst<uint32_t>::snapshot& table) { return table.size(); }));
+
+	handle.rebuild([]() { return test_table_handle_build(8); });
+	handle.wait();
+	EXPECT_EQ(2, swapped);
+	EXPECT_TRUE(reader.check(ntohl(inet_addr("10.1.2.3")), data));
+	EXPECT_EQ(8, data);
+}
+
+TEST(test_table_handle, publish_from_callback)
+{
+	table_handle<basic_lpfst<uint32_t>::snapshot> handle;
+	std::vector<uint64_t> versions;
+	handle.on_swap([&handle, &versions](const basic_lpfst<uint32_t>::snapshot& table, uint64_t version)
+		{
+			versions.push_back(version);
+			if (version == 1)
+				handle.publish(test_table_handle_build(2));
+			else if (version == 2)
+				handle.rebuild([]() { return test_table_handle_build(3); });
+			else if (version == 3) // in the background thread, queued after it
+				handle.rebuild([]() { return test_table_handle_build(4); });
+			// replaced by the nested publish, but still alive
+			uint32_t data = 0;
+			EXPECT_TRUE(table.check((10U << 24) | 1, data));
+			EXPECT_EQ(version, data);
+		});
+	handle.publish(test_table_handle_build(1));
+	handle.wait();
+	EXPECT_EQ(4, handle.version());
+	ASSERT_EQ(4, versions.size());
+	for (size_t i = 0; i < versions.size(); ++i)
+		EXPECT_EQ(i + 1, versions[i]);
+	auto reader = handle.make_reader();
+	uint32_t data = 0;
+	EXPECT_TRUE(reader.check((10U << 24) | 1, data));
+	EXPECT_EQ(4, data);
+}
+
+TEST(test_table_handle, readers_while_swapping)
+{
+	table_handle<basic_lpfst<uint32_t>::snapshot> handle(test_table_handle_build(0));
+	std::atomic<bool> stop{false};
+	std::atomic<size_t> errors{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t)
+	{
+		readers.emplace_back([&handle, &stop, &errors]()
+			{
+				auto reader = handle.make_reader();
+				while (!stop.load())
+				{
+					// every table is consistent: all the prefixes have the same data
+					bool same = reader.read([](const basic_lpfst<uint32_t>::snapshot& table)
+						{
+							uint32_t first = 0, last = 0;
+							table.check((10U << 24) | 1, first);
+							table.check((10U << 24) | (255U << 16) | 1, last);
+							return first == last;
+						});
+					if (!same)
+						++errors;
+				}
+			});
+	}
+	for (uint32_t v = 1; v <= 50; ++v)
+		handle.rebuild([v]() { return test_table_handle_build(v); });
+	handle.wait();
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+	EXPECT_EQ(0, errors.load());
+	EXPECT_EQ(50, handle.version());
+}